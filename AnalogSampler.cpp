@@ -0,0 +1,333 @@
+#include "AnalogSampler.h"
+#include <FspTimer.h>
+#include "pHSensor.h"
+#include "tdsSensor.h"
+#include "RobustFilter.h"
+
+// ============================================
+// STATE
+// ============================================
+//
+// Everything below `armed` is written only by the timer ISR while the channel
+// is armed, and only by analogSamplerArm() (with the timer IRQ masked) to
+// reset it. Foreground readers copy what they need with interrupts masked.
+
+struct ChannelState {
+  uint8_t  pin;
+  volatile bool     armed;
+  volatile uint16_t ring[ANALOG_SAMPLER_RING_LEN];
+  volatile uint8_t  head;          // next write index
+  volatile uint8_t  filled;        // valid counts, saturates at RING_LEN
+  volatile uint8_t  blockTicks;    // counts taken in the current stability block
+  volatile uint32_t blockSum;
+  volatile float    stab[ANALOG_STAB_BLOCKS];
+  volatile uint8_t  stabHead;
+  volatile uint8_t  stabFilled;
+  volatile uint32_t stabSeq;       // blocks closed since boot; never reset
+};
+
+static ChannelState channels[ANALOG_CH_COUNT];
+static FspTimer     sampleTimer;
+static bool         running = false;
+
+static volatile AnalogTickHook tickHook = nullptr;
+
+static uint8_t           mainsHz    = ANALOG_MAINS_DEFAULT_HZ;
+static volatile uint8_t  blockLen   = 0;    // ticks per stability block (whole cycles)
+
+// ============================================
+// HELPERS
+// ============================================
+
+uint16_t analogReadOversampled(uint8_t pin) {
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < (1u << (2 * ANALOG_OVERSAMPLE_BITS)); i++) {
+    sum += (uint32_t)analogRead(pin);
+  }
+  return (uint16_t)(sum >> ANALOG_OVERSAMPLE_BITS);
+}
+
+// ============================================
+// TIMER ISR
+// ============================================
+
+static void onSampleTick(timer_callback_args_t* /*args*/) {
+  uint16_t counts[ANALOG_CH_COUNT] = { 0 };
+  for (uint8_t ch = 0; ch < ANALOG_CH_COUNT; ch++) {
+    ChannelState& c = channels[ch];
+    if (!c.armed) continue;
+
+    uint16_t v = analogReadOversampled(c.pin);
+    counts[ch] = v;
+    c.ring[c.head] = v;
+    c.head = (uint8_t)((c.head + 1) % ANALOG_SAMPLER_RING_LEN);
+    if (c.filled < ANALOG_SAMPLER_RING_LEN) c.filled++;
+
+    // Close a stability block every blockLen counts (whole mains cycles), so
+    // each stability entry is itself hum-free.
+    c.blockSum += v;
+    if (++c.blockTicks >= blockLen) {
+      c.stab[c.stabHead] = (float)c.blockSum / (float)c.blockTicks;
+      c.stabHead = (uint8_t)((c.stabHead + 1) % ANALOG_STAB_BLOCKS);
+      if (c.stabFilled < ANALOG_STAB_BLOCKS) c.stabFilled++;
+      c.stabSeq++;
+      c.blockTicks = 0;
+      c.blockSum   = 0;
+    }
+  }
+
+  AnalogTickHook hook = tickHook;
+  if (hook) hook(counts);
+}
+
+// ============================================
+// MAINS FREQUENCY
+// ============================================
+
+/**
+ * Goertzel amplitude (counts) of one frequency over `n` samples at `fs` Hz.
+ * The detect window holds a whole number of periods of both candidates, so
+ * DC and the other candidate land exactly on zeros of each bin.
+ */
+static float goertzelAmplitude(const uint16_t* x, int n, float f, float fs) {
+  const float coeff = 2.0f * cosf((float)TWO_PI * f / fs);
+  float s1 = 0.0f, s2 = 0.0f;
+  for (int i = 0; i < n; i++) {
+    float s0 = (float)x[i] + coeff * s1 - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+  return 2.0f * sqrtf(power > 0.0f ? power : 0.0f) / (float)n;
+}
+
+/** Sample the pH input at 1 kHz and pick 50 or 60 Hz. Timer must be stopped. */
+static uint8_t detectMainsHz() {
+  // ANALOG_MAINS_DETECT_MS single conversions; 400 B on the stack, once.
+  const int n = ANALOG_MAINS_DETECT_MS;
+  uint16_t x[ANALOG_MAINS_DETECT_MS];
+  unsigned long next = micros();
+  for (int i = 0; i < n; i++) {
+    while ((long)(micros() - next) < 0) { }
+    x[i] = analogReadOversampled(PH_SENSOR_PIN);
+    next += 1000UL;
+  }
+
+  float a50 = goertzelAmplitude(x, n, 50.0f, 1000.0f);
+  float a60 = goertzelAmplitude(x, n, 60.0f, 1000.0f);
+
+  Serial.print("[ADC] Mains detect: 50 Hz = ");
+  Serial.print(a50, 1);
+  Serial.print(", 60 Hz = ");
+  Serial.print(a60, 1);
+  Serial.println(" counts.");
+
+  float strongest = a50 > a60 ? a50 : a60;
+  if (strongest < ANALOG_MAINS_DETECT_MIN_COUNTS) return ANALOG_MAINS_DEFAULT_HZ;
+  return a60 > a50 ? 60 : 50;
+}
+
+static float tickHz() {
+  return (float)mainsHz * ANALOG_SAMPLES_PER_CYCLE;
+}
+
+/** Whole mains cycles nearest ANALOG_STAB_BLOCK_MS, in ticks. */
+static uint8_t stabBlockLen() {
+  unsigned long cycles = ((unsigned long)mainsHz * ANALOG_STAB_BLOCK_MS + 500UL) / 1000UL;
+  if (cycles == 0) cycles = 1;
+  return (uint8_t)(cycles * ANALOG_SAMPLES_PER_CYCLE);
+}
+
+static void resetChannel(ChannelState& c) {
+  c.head       = 0;
+  c.filled     = 0;
+  c.blockTicks = 0;
+  c.blockSum   = 0;
+  c.stabHead   = 0;
+  c.stabFilled = 0;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool analogSamplerInit() {
+  channels[ANALOG_CH_PH].pin  = PH_SENSOR_PIN;
+  channels[ANALOG_CH_TDS].pin = TDS_SENSOR_PIN;
+
+  // Resolution first: the blocking fallbacks use it even without the timer.
+  analogReadResolution(ANALOG_ADC_BITS);
+
+  mainsHz  = (ANALOG_MAINS_HZ == 0) ? detectMainsHz() : ANALOG_MAINS_HZ;
+  blockLen = stabBlockLen();
+
+  uint8_t type = 0;
+  int8_t  tch  = FspTimer::get_available_timer(type);
+  if (tch < 0) {
+    Serial.println("[ADC] No free timer — falling back to blocking reads.");
+    return false;
+  }
+
+  const float hz = tickHz();
+  if (!sampleTimer.begin(TIMER_MODE_PERIODIC, type, (uint8_t)tch, hz, 0.0f, onSampleTick) ||
+      !sampleTimer.setup_overflow_irq() ||
+      !sampleTimer.open() ||
+      !sampleTimer.start()) {
+    Serial.println("[ADC] Timer setup failed — falling back to blocking reads.");
+    return false;
+  }
+
+  running = true;
+  analogSamplerArm(ANALOG_CH_PH);
+
+  Serial.print("[ADC] Background sampler running at ");
+  Serial.print(hz, 0);
+  Serial.print(" Hz per channel (");
+  Serial.print(mainsHz);
+  Serial.print(" Hz mains), ");
+  Serial.print(ANALOG_COUNT_BITS);
+  Serial.println("-bit counts.");
+  return true;
+}
+
+bool analogSamplerRunning() {
+  return running;
+}
+
+void analogSamplerSetTickHook(AnalogTickHook hook) {
+  tickHook = hook;
+}
+
+void analogSamplerArm(AnalogChannel ch) {
+  ChannelState& c = channels[ch];
+  noInterrupts();
+  resetChannel(c);
+  c.armed = true;
+  interrupts();
+}
+
+void analogSamplerDisarm(AnalogChannel ch) {
+  channels[ch].armed = false;
+}
+
+uint8_t analogSamplerMainsHz() {
+  return mainsHz;
+}
+
+bool analogSamplerSetMainsHz(uint8_t hz) {
+  if (hz != 0 && hz != 50 && hz != 60) return false;
+  if (!running) {
+    mainsHz  = hz ? hz : ANALOG_MAINS_DEFAULT_HZ;
+    blockLen = stabBlockLen();
+    return true;
+  }
+
+  // Detection reads the ADC itself, so the ISR must be quiet first.
+  sampleTimer.stop();
+  mainsHz  = hz ? hz : detectMainsHz();
+  blockLen = stabBlockLen();
+  sampleTimer.set_frequency(tickHz());
+
+  noInterrupts();
+  for (uint8_t ch = 0; ch < ANALOG_CH_COUNT; ch++) resetChannel(channels[ch]);
+  interrupts();
+  sampleTimer.start();
+
+  Serial.print("[ADC] Mains sync now ");
+  Serial.print(mainsHz);
+  Serial.println(" Hz.");
+  return true;
+}
+
+bool analogSamplerBoxcar(AnalogChannel ch, uint8_t cycles, float& counts) {
+  uint16_t n = (uint16_t)cycles * ANALOG_SAMPLES_PER_CYCLE;
+  if (n == 0) return false;
+  if (n > ANALOG_SAMPLER_RING_LEN) n = ANALOG_SAMPLER_RING_LEN;
+
+  const ChannelState& c = channels[ch];
+  uint32_t sum = 0;
+
+  noInterrupts();
+  bool ok = running && c.armed && c.filled >= n;
+  if (ok) {
+    uint8_t idx = (uint8_t)((c.head + ANALOG_SAMPLER_RING_LEN - n) % ANALOG_SAMPLER_RING_LEN);
+    for (uint16_t i = 0; i < n; i++) {
+      sum += c.ring[idx];
+      idx = (uint8_t)((idx + 1) % ANALOG_SAMPLER_RING_LEN);
+    }
+  }
+  interrupts();
+
+  if (!ok) return false;
+  counts = (float)sum / (float)n;
+  return true;
+}
+
+bool analogSamplerWaitBoxcar(AnalogChannel ch, uint8_t cycles, float& counts) {
+  if (!running || !channels[ch].armed) return false;
+
+  // The requested cycles to fill, plus one more of slack for the tick in flight.
+  unsigned long timeoutMs = ((unsigned long)(cycles + 1) * 1000UL) / mainsHz + 1;
+  unsigned long t0 = millis();
+  while (!analogSamplerBoxcar(ch, cycles, counts)) {
+    if (millis() - t0 > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+uint8_t analogSamplerBlocks(AnalogChannel ch, float* out, uint8_t n) {
+  if (n > ANALOG_STAB_BLOCKS) n = ANALOG_STAB_BLOCKS;
+  const ChannelState& c = channels[ch];
+
+  noInterrupts();
+  if (!running || !c.armed) n = 0;
+  else if (n > c.stabFilled) n = c.stabFilled;
+  uint8_t idx = (uint8_t)((c.stabHead + ANALOG_STAB_BLOCKS - n) % ANALOG_STAB_BLOCKS);
+  for (uint8_t i = 0; i < n; i++) {
+    out[i] = c.stab[idx];
+    idx = (uint8_t)((idx + 1) % ANALOG_STAB_BLOCKS);
+  }
+  interrupts();
+  return n;
+}
+
+uint32_t analogSamplerBlockSeq(AnalogChannel ch) {
+  noInterrupts();
+  uint32_t seq = channels[ch].stabSeq;
+  interrupts();
+  return seq;
+}
+
+float analogSamplerBlockSeconds() {
+  return (float)blockLen / tickHz();
+}
+
+bool analogSamplerStability(AnalogChannel ch, unsigned long windowMs,
+                            float& medianCounts, float& spreadCounts) {
+  uint8_t n = (uint8_t)(windowMs / ANALOG_STAB_BLOCK_MS);
+  if (n == 0) n = 1;
+  if (n > ANALOG_STAB_BLOCKS) n = ANALOG_STAB_BLOCKS;
+
+  const ChannelState& c = channels[ch];
+  float buf[ANALOG_STAB_BLOCKS];
+
+  noInterrupts();
+  bool ok = running && c.armed && c.stabFilled >= n;
+  if (ok) {
+    uint8_t idx = (uint8_t)((c.stabHead + ANALOG_STAB_BLOCKS - n) % ANALOG_STAB_BLOCKS);
+    for (uint8_t i = 0; i < n; i++) {
+      buf[i] = c.stab[idx];
+      idx = (uint8_t)((idx + 1) % ANALOG_STAB_BLOCKS);
+    }
+  }
+  interrupts();
+
+  if (!ok) return false;
+
+  RobustFilter<ANALOG_STAB_BLOCKS> window;
+  for (uint8_t i = 0; i < n; i++) window.push(buf[i]);
+  spreadCounts = window.spread();
+  medianCounts = window.median();
+  return true;
+}
@@ -0,0 +1,179 @@
+#ifndef ANALOG_SAMPLER_H
+#define ANALOG_SAMPLER_H
+
+#include <Arduino.h>
+
+// ============================================
+// BACKGROUND ANALOG ACQUISITION
+// ============================================
+//
+// A hardware timer (FspTimer on the UNO R4) fires ANALOG_SAMPLES_PER_CYCLE
+// times per mains cycle and reads each armed channel once into a per-channel
+// ring of raw ADC counts. Foreground code never waits on the ADC: a "read" is a
+// boxcar mean over the newest whole cycles in the ring, which costs a few
+// microseconds.
+//
+// Every ~ANALOG_STAB_BLOCK_MS the ISR also pushes the mean of that block into
+// a second, slower ring of ANALOG_STAB_BLOCKS entries. The calibration
+// stability gate (median + peak-to-peak spread over a 2 s window) is read from
+// that ring as a running statistic instead of blocking for the window.
+//
+// Channels are only sampled while ARMED. pH is armed permanently at init. TDS
+// is armed by tdsPowerOn() and disarmed by tdsPowerOff(), so its rings never
+// mix counts from a de-energised probe with live ones. Arming clears both
+// rings for that channel.
+//
+// If no timer channel is free, analogSamplerRunning() returns false and the
+// sensor modules fall back to their original blocking analogRead() loops.
+
+// ---- ADC resolution / scaling (the ONE place analog counts become volts) ----
+// The RA4M1 converter is 14-bit but the core defaults to 10. Every tick reads
+// each channel 4^ANALOG_OVERSAMPLE_BITS times at ANALOG_ADC_BITS, sums, and
+// shifts right by ANALOG_OVERSAMPLE_BITS (oversample-and-decimate), giving
+// ANALOG_COUNT_BITS-bit counts. With the defaults that is 15 bits at 5.0 V:
+// ~0.15 mV/count, versus ~4.9 mV/count at the old 10-bit setting.
+//
+// Calibrations are stored in volts, not counts, so changing any of these
+// needs no EEPROM migration: points captured at 10 bits read back unchanged.
+// Keep ANALOG_COUNT_BITS <= 16 (counts are uint16_t).
+#define ANALOG_REF_VOLTAGE        5.0f    // UNO R4: 5.0 V; 3.3 V boards: change here only
+#define ANALOG_ADC_BITS             14    // 10, 12 or 14
+#define ANALOG_OVERSAMPLE_BITS       1    // extra bits by decimation; 4^N reads per count
+
+#define ANALOG_COUNT_BITS   (ANALOG_ADC_BITS + ANALOG_OVERSAMPLE_BITS)
+#define ANALOG_COUNT_MAX    ((1UL << ANALOG_COUNT_BITS) - 1UL)
+
+/** Convert (possibly fractional, e.g. median) counts to volts. */
+inline float analogCountsToVolts(float counts) {
+  return counts * (ANALOG_REF_VOLTAGE / (float)ANALOG_COUNT_MAX);
+}
+
+// ---- Mains-synchronous timing ----
+// The tick is not a fixed period: it is 1 / (mainsHz * ANALOG_SAMPLES_PER_CYCLE),
+// i.e. exactly ANALOG_SAMPLES_PER_CYCLE evenly spaced counts per mains cycle
+// (5.000 ms at 50 Hz, 4.167 ms at 60 Hz). A plain mean over a whole number of
+// cycles (a boxcar) then sums the hum fundamental and its harmonics below
+// ANALOG_SAMPLES_PER_CYCLE to exactly zero, instead of hoping a median of
+// arbitrarily spaced samples happens to straddle it.
+//
+// ANALOG_MAINS_HZ = 0 auto-detects at boot: ANALOG_MAINS_DETECT_MS of 1 kHz
+// reads on the pH input (an integer number of both 50 and 60 Hz periods) are
+// fed through a Goertzel filter at each frequency and the stronger one wins.
+// If neither reaches ANALOG_MAINS_DETECT_MIN_COUNTS of amplitude (battery or
+// clean USB supply, no hum to cancel) ANALOG_MAINS_DEFAULT_HZ is used. Force
+// 50 or 60 here, or at run time with {"cmd":"set","mains_hz":50|60|0}.
+#define ANALOG_MAINS_HZ                   0   // 0 = auto-detect, else 50 / 60
+#define ANALOG_MAINS_DEFAULT_HZ          50
+#define ANALOG_SAMPLES_PER_CYCLE          4
+#define ANALOG_MAINS_DETECT_MS          200   // 10 x 50 Hz and 12 x 60 Hz periods
+#define ANALOG_MAINS_DETECT_MIN_COUNTS 4.0f   // hum amplitude, ANALOG_COUNT_BITS counts
+
+#define ANALOG_SAMPLER_RING_LEN          32   // counts kept per channel (8 cycles)
+
+// Stability ring: one entry per block, block value = boxcar mean of its counts.
+// A block is the whole number of mains cycles nearest ANALOG_STAB_BLOCK_MS
+// (5 at 50 Hz, 6 at 60 Hz), which matches the old PH/TDS_CAL_STABILITY_SAMPLE_MS
+// spacing; ANALOG_STAB_BLOCKS covers the longest window either module uses.
+#define ANALOG_STAB_BLOCK_MS            100
+#define ANALOG_STAB_BLOCKS               20   // 2 s
+
+// ---- Settling progress ----
+// Calibration captures slide their stability window until it passes or
+// they time out. While they wait they report each evaluation through an
+// optional callback, so a screen can show how close the probe is.
+struct SettleProgress {
+  float         value;       // current stability metric; < 0 while the window fills
+  float         limit;       // accept threshold, same units
+  unsigned long elapsedMs;   // since the capture started
+  unsigned long timeoutMs;   // capture gives up at this
+};
+typedef void (*SettleProgressFn)(const SettleProgress& p);
+
+enum AnalogChannel : uint8_t {
+  ANALOG_CH_PH = 0,
+  ANALOG_CH_TDS,
+  ANALOG_CH_COUNT
+};
+
+/**
+ * Set the ADC resolution, then start the sampling timer and arm the pH
+ * channel. False if no timer is free (the resolution is still applied).
+ */
+bool analogSamplerInit();
+
+/**
+ * One oversampled, decimated count (0..ANALOG_COUNT_MAX) taken in the
+ * caller's context. Used by the ISR and by the blocking fallbacks.
+ */
+uint16_t analogReadOversampled(uint8_t pin);
+
+/** True once the timer is running (otherwise callers must sample themselves). */
+bool analogSamplerRunning();
+
+/**
+ * Called from the timer ISR after every tick with that tick's count per
+ * channel (indexed by AnalogChannel, 0 for a disarmed channel). Runs in
+ * interrupt context: it must be short, must not block or touch I2C/BLE, and
+ * must not call noInterrupts()/interrupts().
+ */
+typedef void (*AnalogTickHook)(const uint16_t* counts);
+
+/** Install the per-tick hook (nullptr removes it). Only one at a time. */
+void analogSamplerSetTickHook(AnalogTickHook hook);
+
+/** Clear a channel's rings and start sampling it. */
+void analogSamplerArm(AnalogChannel ch);
+
+/** Stop sampling a channel. Its buffered counts are discarded on the next arm. */
+void analogSamplerDisarm(AnalogChannel ch);
+
+/** Mains frequency the tick is currently locked to (50 or 60). */
+uint8_t analogSamplerMainsHz();
+
+/**
+ * Re-time the sampler for 50 or 60 Hz mains, or re-run auto-detection with
+ * 0. Both armed channels restart with empty rings, since counts taken at the
+ * old spacing would no longer boxcar to zero. False for any other value.
+ */
+bool analogSamplerSetMainsHz(uint8_t hz);
+
+/**
+ * Boxcar mean of the newest `cycles` whole mains cycles
+ * (cycles * ANALOG_SAMPLES_PER_CYCLE counts). False if the channel is
+ * disarmed or has not yet collected that many counts since it was armed.
+ */
+bool analogSamplerBoxcar(AnalogChannel ch, uint8_t cycles, float& counts);
+
+/**
+ * Block until `cycles` whole cycles are buffered (at most that long plus a
+ * tick of margin), then return their boxcar mean. Used right after arming,
+ * when the ring is still empty.
+ */
+bool analogSamplerWaitBoxcar(AnalogChannel ch, uint8_t cycles, float& counts);
+
+/**
+ * Copy the newest n stability-block means (oldest first) into `out`. Returns
+ * how many were copied: fewer than n while the window is still filling, 0 if
+ * the channel is disarmed.
+ */
+uint8_t analogSamplerBlocks(AnalogChannel ch, float* out, uint8_t n);
+
+/**
+ * Count of stability blocks the channel has closed since boot. Never reset
+ * (arming does not rewind it), so the difference between two calls is how
+ * many of the newest blocks were taken in between.
+ */
+uint32_t analogSamplerBlockSeq(AnalogChannel ch);
+
+/** Spacing of stability blocks in seconds (whole mains cycles, ~0.1 s). */
+float analogSamplerBlockSeconds();
+
+/**
+ * Running stability statistic over the newest windowMs of block means:
+ * median and peak-to-peak spread, both in raw counts. Returns false until the
+ * channel has been armed for a full window.
+ */
+bool analogSamplerStability(AnalogChannel ch, unsigned long windowMs,
+                            float& medianCounts, float& spreadCounts);
+
+#endif
@@ -10,11 +10,18 @@
 #include "pHSensor.h"
 #include "colourSensor.h"
 #include "tdsSensor.h"
+#include "AnalogSampler.h"
+#include "TempSensor.h"
+#include "Monitor.h"
 #include "cameraSensor.h"
+#include "History.h"
+#include "DiagStream.h"
 #include <U8g2lib.h>
 #include <Wire.h>
 #include <ArduinoBLE.h>
 #include <ArduinoJson.h>
+#include <malloc.h>
+#include <unistd.h>   // sbrk(): current end of the heap
 
 #define DEVICE_NAME    "URINE-TEST-001"
 #define DEVICE_VERSION "1.0"
@@ -38,7 +45,13 @@ static bool inCameraCal    = false;
 static bool inBothColorCal = false;
 static bool inIlluminatorAdjust  = false;
 static bool inIlluminator2Adjust = false;   // secondary illuminator (D10)
+
+// startTest() waits on its result pages only when a person started it;
+// tests run by BLE command (see BLE COMMANDS) clear this.
+static bool     testInteractive = true;
+static uint32_t lastTestSeq     = 0;   // history seq of the most recent test
 static bool inDevDiagnostics = false;   // hidden developer live-readings screen
+static bool inMonitor        = false;   // Sensors > Live Monitor
 
 // ============================================
 // HIDDEN DEVELOPER UNLOCK
@@ -89,6 +102,7 @@ void openCameraCalibration();
 void resetCameraCalibration();
 
 void openBluetoothSettings();
+void openMonitor();
 
 // Screen runners
 void runCalibrationScreen();
@@ -100,6 +114,7 @@ void runBluetoothSettingsScreen();
 void runIlluminatorAdjustScreen();
 void runIlluminator2AdjustScreen();
 void runDevDiagnosticsScreen();   // hidden developer live-readings screen
+void runMonitorScreen();
 
 // Universal back navigation (key 8 from any menu)
 void goBackUniversal();
@@ -133,9 +148,10 @@ Menu sensorsMenu = {
     {"pH Sensor",          openPH},
     {"Color Sensors",      openColorSensors},
     {"TDS Sensor",         openTDS},
+    {"Live Monitor",       openMonitor},
     {"Back to Main Menu",  backToMain},
   },
-  4
+  5
 };
 
 // ---- Color Sensors umbrella ----
@@ -514,6 +530,58 @@ void runBluetoothAdvancedScreen() {
   }
 }
 
+// ============================================
+// CALIBRATION SETTLING INDICATOR
+// ============================================
+//
+// Passed to calCapture() / tdsCalCapture() as their SettleProgressFn and
+// drawn at every evaluation of the sliding stability window: the current
+// metric against its limit, and a bar filling towards the capture timeout.
+// The capture blocks the screen loop meanwhile, so BLE is polled here.
+static void drawSettleProgress(const char* title, const char* unit,
+                               const SettleProgress& p) {
+  u8g2.clearBuffer();
+  u8g2.setFont(u8g2_font_6x10_tf);
+  u8g2.drawStr(0, 10, title);
+  u8g2.drawHLine(0, 12, 128);
+  u8g2.drawStr(0, 26, "Settling...");
+
+  char buf[24];
+  if (p.value < 0.0f) {
+    snprintf(buf, sizeof(buf), "Filling window");
+  } else {
+    snprintf(buf, sizeof(buf), "%.2f (<%.1f) %s", p.value, p.limit, unit);
+  }
+  u8g2.drawStr(0, 40, buf);
+
+  unsigned long w = p.timeoutMs ? p.elapsedMs * 128UL / p.timeoutMs : 128UL;
+  u8g2.drawFrame(0, 48, 128, 6);
+  u8g2.drawBox(0, 48, (w > 128UL) ? 128 : (uint8_t)w, 6);
+  u8g2.setFont(u8g2_font_5x7_tf);
+  u8g2.drawStr(0, 63, "Hold probe still");
+  u8g2.setFont(u8g2_font_6x10_tf);
+  u8g2.sendBuffer();
+  BLE.poll();
+}
+
+static void phSettleProgress(const SettleProgress& p) {
+  drawSettleProgress("-- pH Calibration --", "mV/s", p);
+}
+
+static void tdsSettleProgress(const SettleProgress& p) {
+  drawSettleProgress("-- TDS Calibration -", "mV", p);
+}
+
+/** Brief notice after a capture that timed out without settling. */
+static void showCaptureRejected() {
+  u8g2.clearBuffer();
+  u8g2.setFont(u8g2_font_6x10_tf);
+  u8g2.drawStr(4, 28, "Not stable - timed");
+  u8g2.drawStr(4, 40, "out. Press to retry.");
+  u8g2.sendBuffer();
+  delay(1200);
+}
+
 // ============================================
 // pH CALIBRATION SCREEN
 // ============================================
@@ -567,7 +635,9 @@ void runCalibrationScreen() {
         delay(1500);
         break;
       } else {
-        calCapture();
+        // calCapture() blocks until the electrode stops drifting (up to
+        // PH_ENDPOINT_CAL_TIMEOUT_MS); the indicator shows the drift live.
+        if (!calCapture(phSettleProgress)) showCaptureRejected();
       }
     } else if (key == 2 || key == 10) {
       calCancel();
@@ -975,7 +1045,12 @@ void runTDSCalibrationScreen() {
         delay(2000);
         break;
       } else {
-        tdsCalCapture();
+        // Slides the stability window until it passes (see tdsSensor.h);
+        // the standard's temperature comes from the DS18B20 if fitted.
+        if (!tdsCalCapture(pHReadTemperature(), tdsSettleProgress)) {
+          showCaptureRejected();
+          continue;
+        }
         u8g2.clearBuffer();
         u8g2.setFont(u8g2_font_6x10_tf);
         if (tdsCalStep == TDS_CAL_HIGH) {
@@ -1098,12 +1173,13 @@ void runCameraCalibrationScreen() {
         u8g2.drawStr(16, 32, "Capturing...");
         u8g2.sendBuffer();
 
-        // For the WHITE reference the external LEDs were only switched on at
-        // the top of this loop iteration, so give them + the camera AEC/AWB a
-        // moment to settle before the capture. (DARK is shot in the dark, so
-        // no settle is needed there.)
+        // For the WHITE reference the external LEDs may only just have been
+        // switched on at the top of this loop iteration, so give them + the
+        // camera AEC/AWB a moment to settle before the capture — returns
+        // immediately if the keep-warm stream already reports convergence.
+        // (DARK is shot in the dark, so no settle is needed there.)
         if (camCalStep == CAM_CAL_WHITE) {
-          delay(CAM_LIGHT_SETTLE_MS);
+          cameraAwaitLightSettle(illuminatorLastChangeMs());
         }
         camCalCapture();
 
@@ -1299,6 +1375,10 @@ void runBothColorCalibrationScreen() {
   // Both are in COLOR_CAL_DARK / CAM_CAL_DARK after their *Begin() calls.
   colorCalBegin();
   if (useCam) camCalBegin();
+  // Wall time for the whole sequence (including the user swapping references)
+  // and the part of it spent inside the captures themselves.
+  unsigned long calStartedMs = millis();
+  unsigned long captureMs    = 0;
   // Illumination is step-gated (see the live-preview and capture blocks below):
   // the DARK reference is captured with EVERY light off so both sensors see a
   // true black level; the WHITE reference lights each sensor with its OWN light
@@ -1399,11 +1479,22 @@ void runBothColorCalibrationScreen() {
           camSaved = (camCalStep == CAM_CAL_IDLE);
         }
 
+        unsigned long totalMs = millis() - calStartedMs;
+        Serial.print("[Cal] RGB+Cam sequence: total ");
+        Serial.print(totalMs);
+        Serial.print(" ms, capturing ");
+        Serial.print(captureMs);
+        Serial.println(" ms");
+
         u8g2.clearBuffer();
         u8g2.setFont(u8g2_font_6x10_tf);
         if (rgbSaved && camSaved) {
           u8g2.drawStr(0, 22, "Both saved!");
           u8g2.setFont(u8g2_font_5x7_tf);
+          char tBuf[24];
+          snprintf(tBuf, sizeof(tBuf), "%lus (capt %lu.%lus)",
+                   totalMs / 1000, captureMs / 1000, (captureMs % 1000) / 100);
+          u8g2.drawStr(0, 60, tBuf);
           if (useCam) {
             char wBuf[24];
             snprintf(wBuf, sizeof(wBuf), "RGB W R:%u G:%u",
@@ -1453,39 +1544,51 @@ void runBothColorCalibrationScreen() {
       // Are we capturing the DARK reference right now? If so EVERY light stays
       // off for both sensors so each captures a true black level.
       bool capturingDark = (rgbBefore == COLOR_CAL_DARK);
+      unsigned long captureStart = millis();
 
-      // AS7341 first. DARK → all off; WHITE → external off, on-board LED on
-      // (the AS7341's own illuminant). Assert the state here, then let it settle
-      // before the capture integrates.
+      bool rgbAdvanced;
+      bool camAdvanced = true;
       if (capturingDark) {
+        // DARK: both sensors want the same light state (everything off), so
+        // the captures overlap — the ESP32 does its warm-up + CAL_DARK while
+        // the AS7341 runs its leak check and integrates. The camera's settle
+        // wait has to come first: it polls the UART, which would swallow the
+        // CAL_DARK reply if it ran while the command was in flight.
         illuminatorOff();
         colorOnboardLedOff();
+        if (useCam) cameraAwaitLightSettle(illuminatorLastChangeMs());
+        else        delay(COLOR_FLASH_SETTLE_MS);
+        bool camStarted = useCam && camCalCaptureStart();
+
+        colorCalCapture();
+        rgbAdvanced = (colorCalStep != rgbBefore);
+
+        if (useCam) {
+          if (camStarted) camCalCaptureFinish();
+          camAdvanced = (camCalStep != camBefore);
+        }
       } else {
-        illuminatorOff();
-        colorOnboardLedOn();
-      }
-      delay(COLOR_FLASH_SETTLE_MS);
-      colorCalCapture();
-      bool rgbAdvanced = (colorCalStep != rgbBefore);
-
-      // Camera second (slow, can fail). DARK → all off (true black level);
-      // WHITE → external white LEDs on with the AS7341 on-board LED OFF, the
-      // SAME light the camera sees in a real test (startTest). Capturing the
-      // camera's white reference under any other light would bake that light
-      // into every measured frame.
-      bool camAdvanced = true;
-      if (useCam) {
-        if (capturingDark) {
-          illuminatorOff();
-          colorOnboardLedOff();
-        } else {
+        // WHITE: the two sensors need DIFFERENT light (camera under the
+        // external white LEDs, the SAME light it sees in startTest; AS7341
+        // under its on-board LED only), so these can't overlap. Camera first:
+        // the preview above already has the external LEDs on and the on-board
+        // LED off, so the settle wait is normally a no-op and we save one
+        // full light transition + AEC/AWB settle.
+        if (useCam) {
           colorOnboardLedOff();
           illuminatorOn();
+          cameraAwaitLightSettle(illuminatorLastChangeMs());   // LEDs + camera AEC/AWB
+          camCalCapture();
+          camAdvanced = (camCalStep != camBefore);
         }
-        delay(CAM_LIGHT_SETTLE_MS);   // let the LEDs + camera AEC/AWB settle
-        camCalCapture();
-        camAdvanced = (camCalStep != camBefore);
+
+        illuminatorOff();
+        colorOnboardLedOn();
+        delay(COLOR_FLASH_SETTLE_MS);
+        colorCalCapture();
+        rgbAdvanced = (colorCalStep != rgbBefore);
       }
+      captureMs += millis() - captureStart;
 
       // ---- Result handling ----
       if (rgbAdvanced && camAdvanced) {
@@ -1547,7 +1650,7 @@ void runBothColorCalibrationScreen() {
             colorOnboardLedOff();
             illuminatorOn();
           }
-          delay(CAM_LIGHT_SETTLE_MS);   // let the LEDs + camera AEC/AWB settle
+          cameraAwaitLightSettle(illuminatorLastChangeMs());   // LEDs + camera AEC/AWB
           camCalCapture();
 
           if ((colorCalStep == COLOR_CAL_WHITE  && camCalStep == CAM_CAL_WHITE) ||
@@ -1669,7 +1772,8 @@ void runBothColorCalibrationScreen() {
 //   │       ├── colorSensorsMenu   → sensorsMenu
 //   │       │   ├── RGBMenu        → colorSensorsMenu
 //   │       │   └── cameraMenu     → colorSensorsMenu
-//   │       └── TDSMenu            → sensorsMenu
+//   │       ├── TDSMenu            → sensorsMenu
+//   │       └── (Live Monitor: full-screen takeover)
 //   └── (BT settings handled as full-screen takeover)
 //
 // Note: this is parallel to the existing in-menu "Back" items — those
@@ -1706,6 +1810,7 @@ void goBackUniversal() {
 //   2. RGB raw R/G/B/C
 //   3. RGB normalised + lux + CCT + illuminator
 //   4. Camera RGB + BLE status
+//   5. Boot timing table (per-subsystem cold-start ms)
 //
 // Controls:
 //   UP   (2)  — previous page
@@ -1717,8 +1822,53 @@ void goBackUniversal() {
 // and camera UART) are slow. To keep the UI responsive we refresh
 // the screen every ~250 ms and only sample the page-relevant sensors
 // each tick. The camera is only polled when page 4 is active.
+// Draws the dev page 5 body; defined with the boot sequencer below.
+static void drawBootTimingLines();
+
+// ---- Heap / stack watermark (dev page 6) ----
+// newlib never returns memory to the system, so mallinfo().arena is the
+// heap's high-water mark. memGapLow is the smallest stack-to-heap gap seen
+// by memTrackLowWater(), sampled once per loop() and on page 6. Every
+// JsonDocument (replies, notifications, parsed commands) allocates its pool
+// on the heap; "JSON pk" is the most heap in use seen while one was alive
+// (bleJsonHeapPeak()) and which document it was.
+static unsigned memGapLow = 0xFFFF;
+
+static unsigned memStackHeapGap() {
+  char top;
+  return (unsigned)(&top - (char*)sbrk(0));
+}
+
+static void memTrackLowWater() {
+  unsigned gap = memStackHeapGap();
+  if (gap < memGapLow) memGapLow = gap;
+}
+
+static void drawHeapLines() {
+  struct mallinfo mi = mallinfo();
+  memTrackLowWater();
+
+  char buf[28];
+  snprintf(buf, sizeof(buf), "Heap HWM:  %6u B", (unsigned)mi.arena);
+  u8g2.drawStr(0, 22, buf);
+  snprintf(buf, sizeof(buf), "In use:    %6u B", (unsigned)mi.uordblks);
+  u8g2.drawStr(0, 31, buf);
+  // Free space stranded inside the arena, and how many pieces it's in:
+  // many small blocks = fragmentation.
+  unsigned fragPct = mi.arena ? (unsigned)(mi.fordblks * 100UL / mi.arena) : 0;
+  snprintf(buf, sizeof(buf), "Holes: %5u B/%u (%u%%)",
+           (unsigned)mi.fordblks, (unsigned)mi.ordblks, fragPct);
+  u8g2.drawStr(0, 40, buf);
+  snprintf(buf, sizeof(buf), "Gap: %5u low %5u", memStackHeapGap(), memGapLow);
+  u8g2.drawStr(0, 49, buf);
+  const char* jsonPath;
+  size_t jsonPeak = bleJsonHeapPeak(&jsonPath);
+  snprintf(buf, sizeof(buf), "JSON pk %5u %s", (unsigned)jsonPeak, jsonPath);
+  u8g2.drawStr(0, 57, buf);
+}
+
 void runDevDiagnosticsScreen() {
-  const uint8_t PAGE_COUNT = 4;
+  const uint8_t PAGE_COUNT = 6;
   uint8_t page = 0;
 
   // Cached last camera reading — camera reads are slow (~hundreds of
@@ -1815,11 +1965,13 @@ void runDevDiagnosticsScreen() {
                (unsigned)illuminator2GetBrightness());
       u8g2.drawStr(0, 59, buf);
     }
-    else {
+    else if (page == 3) {
       // ---- Page 4: Camera + BLE ----
       // Refresh camera on every tick of this page so devs see live
       // changes. Cached value persists for label correctness if a
-      // read fails mid-session.
+      // read fails mid-session. Paging here from an AS7341 page just turned
+      // the external LEDs back on, so let the camera re-converge first.
+      cameraAwaitLightSettle(illuminatorLastChangeMs());
       CameraRGB cam = cameraRead();
       if (cam.valid) {
         lastCam = cam;
@@ -1848,9 +2000,30 @@ void runDevDiagnosticsScreen() {
       if (!bleSettings.advertisingEnabled)      bleStr = "BLE: OFF";
       else if (conn)                            bleStr = "BLE: Connected";
       else                                      bleStr = "BLE: Adv";
-      u8g2.drawStr(0, 53, bleStr);
+      u8g2.drawStr(0, 49, bleStr);
       snprintf(buf, sizeof(buf), "TX:%ddBm", (int)bleSettings.txPower);
-      u8g2.drawStr(72, 53, buf);
+      u8g2.drawStr(72, 49, buf);
+
+      // Link quality: live RSSI / MTU / uptime while connected, otherwise
+      // the connect/disconnect counters since boot.
+      if (conn) {
+        snprintf(buf, sizeof(buf), "%ddBm MTU%u up%lus", bleReadRssi(),
+                 (unsigned)bleLink.attMtu, (millis() - bleLink.connectedAt) / 1000);
+      } else {
+        snprintf(buf, sizeof(buf), "conn %lu drop %lu",
+                 (unsigned long)bleLink.connects, (unsigned long)bleLink.disconnects);
+      }
+      u8g2.drawStr(0, 56, buf);
+    }
+
+    else if (page == 4) {
+      // ---- Page 5: Boot timing ----
+      drawBootTimingLines();
+    }
+
+    else {
+      // ---- Page 6: Heap / stack ----
+      drawHeapLines();
     }
 
     // Footer hint
@@ -1858,6 +2031,9 @@ void runDevDiagnosticsScreen() {
     u8g2.setFont(u8g2_font_6x10_tf);
     u8g2.sendBuffer();
 
+    // Keep a host's diagnostics stream going while the dev screen is up.
+    diagStreamService();
+
     // ---- Input ----
     // Shorter delay than menus so live values update visibly.
     int key = scanKey();
@@ -1894,6 +2070,60 @@ void runDevDiagnosticsScreen() {
   setMenu(&mainMenu);
 }
 
+// ============================================
+// LIVE MONITOR SCREEN
+// ============================================
+//
+// Shows the monitoring averages (see Monitor.h) and keeps them updating.
+// If monitoring was not already running (started over BLE), the screen
+// starts it at MONITOR_DEFAULT_PERIOD_MS and stops it again on exit; a
+// host-started session is left running.
+void runMonitorScreen() {
+  bool ownSession = !monitorActive();
+  if (ownSession) monitorSetPeriod(MONITOR_DEFAULT_PERIOD_MS);
+
+  while (true) {
+    monitorService();
+    MonitorReading m = monitorReading();
+
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_6x10_tf);
+    u8g2.drawStr(0, 10, "-- Live Monitor --");
+    u8g2.drawHLine(0, 12, 128);
+
+    char buf[28];
+    if (m.samples == 0) {
+      u8g2.drawStr(0, 26, "Starting...");
+    } else {
+      snprintf(buf, sizeof(buf), "pH:   %.2f", m.pH);
+      u8g2.drawStr(0, 24, buf);
+      snprintf(buf, sizeof(buf), "Temp: %.1f C", m.tempC);
+      u8g2.drawStr(0, 35, buf);
+      if (m.tdsValid) {
+        snprintf(buf, sizeof(buf), "TDS:  %.0f ppm", m.tdsPpm);
+      } else {
+        snprintf(buf, sizeof(buf), "TDS:  settling...");
+      }
+      u8g2.drawStr(0, 46, buf);
+    }
+
+    u8g2.setFont(u8g2_font_5x7_tf);
+    snprintf(buf, sizeof(buf), "n=%lu tx=%lu  k8:exit",
+             (unsigned long)m.samples, (unsigned long)m.notifies);
+    u8g2.drawStr(0, 63, buf);
+    u8g2.setFont(u8g2_font_6x10_tf);
+    u8g2.sendBuffer();
+
+    if (scanKey() == 8) break;
+    delay(100);
+    BLE.poll();
+  }
+
+  if (ownSession) monitorSetPeriod(0);
+  inMonitor = false;
+  setMenu(&sensorsMenu);
+}
+
 // ============================================
 // MENU ACTION CALLBACKS
 // ============================================
@@ -1902,13 +2132,14 @@ void runDevDiagnosticsScreen() {
 // Used by BOTH the test loading screen (startTest, below) and the boot loading
 // screen (drawBootFrame, further down). They must be declared before the first
 // use, which is startTest(), so they live here rather than in the boot section.
-static const uint8_t BOOT_STEPS_TOTAL = 6;   // boot init steps
+static const uint8_t BOOT_STEPS_TOTAL = 8;   // boot init steps (one per BootTask)
 static const uint8_t TEST_STEPS_TOTAL = 5;   // test acquisition steps
 
 // Status tags (kept short for the small font)
 #define BOOT_OK     "OK"
 #define BOOT_WARN   "WARN"
 #define BOOT_FAIL   "FAILED"
+#define BOOT_BG     "BG"       // started, finishing in the background
 
 // Title bar shown on every test-loading frame.
 #define TEST_TITLE "-- Testing ---------"
@@ -1921,19 +2152,35 @@ static void drawProgressFrame(const char* title, const char* stepLabel,
                               const char* statusLabel, uint8_t stepsCompleted,
                               uint8_t stepsTotal);
 
+/**
+ * Round v * scale to the nearest integer, clamped to [lo, hi], for the
+ * fixed-point fields of BLEResultV1.
+ */
+static int32_t toFixed(float v, float scale, int32_t lo, int32_t hi) {
+  float f = v * scale;
+  f += (f < 0.0f) ? -0.5f : 0.5f;
+  if (f <= (float)lo) return lo;
+  if (f >= (float)hi) return hi;
+  return (int32_t)f;
+}
+
 void startTest() {
+  // Start a temperature conversion before anything else; it runs while the
+  // pH endpoint and the TDS settle below take their readings.
+  tempStartConversion();
+
   // ---- Step 1/5: pH & Temp ----
   // Mirror the boot loading screen: each frame announces the step about to
   // run and shows the PREVIOUS step's result badge. prevStatus carries that
-  // result forward. The pH/temp path has no error sentinel (it always returns
-  // a plausible value), so step 1 is treated as OK.
+  // result forward. Step 1 is OK once the pH electrode reaches its endpoint,
+  // WARN if it was still drifting at PH_ENDPOINT_TEST_TIMEOUT_MS.
   drawProgressFrame(TEST_TITLE, "pH & Temp...", "", 0, TEST_STEPS_TOTAL);
   BLE.poll();
   const char* prevStatus = BOOT_OK;
 
   // ---- Notify connected central that a test has begun ----
   if (isBluetoothConnected()) {
-    StaticJsonDocument<64> startDoc;
+    JsonDocument startDoc;
     startDoc["device"] = DEVICE_NAME;
     startDoc["type"]   = "test_started";
     sendJsonData(startDoc);
@@ -1943,19 +2190,15 @@ void startTest() {
   // ---- Collect all sensor data ----
   // Power the TDS probe NOW so the DFR0504 isolator's input stage starts
   // settling immediately. The pH/temp reads below cover part of that
-  // settle window "for free"; we then top up to a full TDS_POWER_SETTLE_MS
-  // before sampling. Because the probe is already on, tdsRead() detects
-  // "already powered" and samples without re-running its own power cycle.
-  // This mirrors why the live calibration screen reads correctly: the
-  // isolator gets enough continuous powered time to lock before sampling.
+  // settle window "for free"; tdsSettleAndRead() then counts from power-on
+  // and returns as soon as the step response can be extrapolated, with
+  // TDS_POWER_SETTLE_MS as the upper bound. The probe stays on throughout,
+  // so no read below re-runs its own power cycle.
   tdsPowerOn();
 
-  float temp = pHReadTemperature();
-  float pH   = pHRead(temp);
-
-  // Top up the isolator settle. pH/temp reads already consumed part of it,
-  // but delay a full window here to stay robust if those reads are fast.
-  delay(TDS_POWER_SETTLE_MS);
+  PHEndpoint phEp;
+  pHReadEndpoint(phEp, PH_ENDPOINT_TEST_TIMEOUT_MS);
+  if (!phEp.stable) prevStatus = BOOT_WARN;
 
   // ---- Step 2/5: TDS & EC ---- (pH/Temp done → OK)
   drawProgressFrame(TEST_TITLE, "TDS & EC...", prevStatus, 1, TEST_STEPS_TOTAL);
@@ -1965,10 +2208,18 @@ void startTest() {
   Serial.print("[Test-TDS] vLow=");   Serial.print(tdsCalData.low.voltage, 4);
   Serial.print("  vHigh=");           Serial.println(tdsCalData.high.voltage, 4);
   Serial.print("[Test-TDS] magic=0x"); Serial.println(tdsCalData.magic, HEX);
-  float ecVoltage = tdsReadVoltage();
+  float ecVoltage = tdsSettleAndRead();
   Serial.print("[Test-TDS] ecVoltage="); Serial.println(ecVoltage, 4);
 
-  //float ecVoltage = tdsReadVoltage();
+  // Temperature for both compensations. The pH endpoint waits at least one
+  // PH_ENDPOINT_WINDOW_MS of fresh blocks, longer than a 12-bit conversion,
+  // so the reading is normally waiting. If not (slow conversion, CRC retry),
+  // a reading younger than TEMP_REFRESH_MS is as good as a fresh one for a
+  // cup of liquid: take whatever is ready. Otherwise wait out the conversion.
+  tempCollect(tempAgeMs() < TEMP_REFRESH_MS ? 0 : tempConversionMs());
+  float temp = pHReadTemperature();
+  float pH   = voltageToPH(phEp.voltage, temp);
+
   Serial.print("EC Voltage: ");
   Serial.print(ecVoltage);
   float ec = voltageToEC(ecVoltage, temp);
@@ -2036,9 +2287,15 @@ void startTest() {
     prevStatus = BOOT_OK;
   }
 
+  // Fields the connected app asked for ("fields" command); everything when
+  // standalone. CCT and the camera are skipped outright when not wanted.
+  uint16_t fields    = bleResultFields();
+  bool     cctWanted = (fields & RESULT_FIELD_CCT) != 0;
+  bool     camWanted = (fields & RESULT_FIELD_CAMERA) != 0;
+
   NormalisedRGB rgb = colorNormalise(raw);
   float         lux = colorCalcLux(raw);
-  uint16_t      cct = colorCalcCCT(raw);
+  uint16_t      cct = cctWanted ? colorCalcCCT(raw) : 0;
 
   char hexColor[8];
   snprintf(hexColor, sizeof(hexColor), "#%02X%02X%02X", rgb.r, rgb.g, rgb.b);
@@ -2054,16 +2311,26 @@ void startTest() {
   // the whole capture (the AS7341's on-board LED is already off, so it can't
   // appear as a hot-spot in the frame). Returns valid=false silently if the
   // ESP32 isn't connected/fails.
+  //
+  // The settle only waits for what hasn't already elapsed since the LEDs last
+  // changed; with keep-warm streaming the read is then served straight from
+  // the cached converged frame instead of a fresh ESP32 capture.
+  //
+  // Skipped entirely (no settle, no UART round trip) when the connected app
+  // didn't ask for camera data; the stored record is flagged "not measured".
+  CameraRGB cam = {0, 0, 0, false};
   illuminatorOn();                       // external LEDs on for the camera
-  delay(CAM_LIGHT_SETTLE_MS);            // let the LEDs + camera AEC/AWB settle
-  CameraRGB cam = cameraRead();
+  if (camWanted) {
+    cameraAwaitLightSettle(illuminatorLastChangeMs());
+    cam = cameraRead();
+  }
   char hexCam[8] = "";
   if (cam.valid) {
     snprintf(hexCam, sizeof(hexCam), "#%02X%02X%02X", cam.r, cam.g, cam.b);
   }
 
   // Camera is optional hardware — offline/timeout is a WARN, never a FAIL.
-  prevStatus = cam.valid ? BOOT_OK : BOOT_WARN;
+  prevStatus = (cam.valid || !camWanted) ? BOOT_OK : BOOT_WARN;
 
   // Camera done — leave the external LEDs on (idle/menu light); the AS7341
   // on-board LED is already off. The live/menu and dev-diagnostics screens
@@ -2092,65 +2359,124 @@ void startTest() {
   Serial.print(" B="); Serial.println(rgb.b);
   Serial.print("[Test] Color:   "); Serial.println(hexColor);
   Serial.print("[Test] Lux:     "); Serial.println(lux, 1);
-  Serial.print("[Test] CCT:     "); Serial.print(cct); Serial.println(" K");
+  if (cctWanted) { Serial.print("[Test] CCT:     "); Serial.print(cct); Serial.println(" K"); }
+  else           Serial.println("[Test] CCT:     (not requested)");
   if (cam.valid) {
     Serial.print("[Test] Cam   R="); Serial.print(cam.r);
     Serial.print(" G=");              Serial.print(cam.g);
     Serial.print(" B=");              Serial.println(cam.b);
     Serial.print("[Test] CamHex: "); Serial.println(hexCam);
   } else {
-    Serial.println("[Test] Cam:     (offline)");
+    Serial.println(camWanted ? "[Test] Cam:     (offline)" : "[Test] Cam:     (not requested)");
   }
   Serial.println("[Test] ==================================");
 
   // ---- Build JSON payload ----
-  StaticJsonDocument<1024> doc;   // bumped from 768 to leave headroom for ec_sample + sg
+  JsonDocument doc;
 
   doc["device"]  = DEVICE_NAME;
   doc["version"] = DEVICE_VERSION;
   doc["type"]    = "urinalysis";
 
-  JsonObject sensors = doc.createNestedObject("sensors");
-  sensors["temp_c"]   = temp;
-  sensors["pH"]       = pH;
-  sensors["tds_ppm"]  = tds;
-  sensors["ec_us_cm"] = ec;
-  sensors["ec_sample_us_cm"] = ecSample;   // neat-urine conductivity (dilution-corrected)
-  sensors["sg"]              = sg;          // specific gravity (0.0 = calibration fault)
-
-  JsonObject color = sensors.createNestedObject("color");
-  color["r"]   = rgb.r;
-  color["g"]   = rgb.g;
-  color["b"]   = rgb.b;
-  color["hex"] = hexColor;
-  color["lux"] = lux;
-  color["cct"] = cct;
+  // Only the fields the connected app asked for (all of them by default).
+  JsonObject sensors = doc["sensors"].to<JsonObject>();
+  if (fields & RESULT_FIELD_TEMP) sensors["temp_c"]  = temp;
+  if (fields & RESULT_FIELD_PH) {
+    sensors["pH"]            = pH;
+    sensors["ph_settle_ms"]  = phEp.elapsedMs;
+    sensors["ph_drift_mv_s"] = phEp.driftMvPerS;
+    sensors["ph_stable"]     = phEp.stable;
+  }
+  if (fields & RESULT_FIELD_TDS)  sensors["tds_ppm"] = tds;
+  if (fields & RESULT_FIELD_EC) {
+    sensors["ec_us_cm"]        = ec;
+    sensors["ec_sample_us_cm"] = ecSample;   // neat-urine conductivity (dilution-corrected)
+  }
+  if (fields & RESULT_FIELD_SG)   sensors["sg"]      = sg;   // specific gravity (0.0 = calibration fault)
+
+  if (fields & (RESULT_FIELD_COLOR | RESULT_FIELD_LUX | RESULT_FIELD_CCT)) {
+    JsonObject color = sensors["color"].to<JsonObject>();
+    if (fields & RESULT_FIELD_COLOR) {
+      color["r"]   = rgb.r;
+      color["g"]   = rgb.g;
+      color["b"]   = rgb.b;
+      color["hex"] = hexColor;
+    }
+    if (fields & RESULT_FIELD_LUX) color["lux"] = lux;
+    if (fields & RESULT_FIELD_CCT) color["cct"] = cct;
+  }
 
   // Camera (ESP32-CAM via UART) — only included if the read succeeded.
-  if (cam.valid) {
-    JsonObject camera = sensors.createNestedObject("camera");
+  if (cam.valid && (fields & RESULT_FIELD_CAMERA)) {
+    JsonObject camera = sensors["camera"].to<JsonObject>();
     camera["r"]   = cam.r;
     camera["g"]   = cam.g;
     camera["b"]   = cam.b;
     camera["hex"] = hexCam;
   }
 
+  // ---- Compact binary form: stored in history, and sent if the app asked ----
+  BLEResultV1 bin;
+  bin.magic         = BLE_RESULT_BIN_MAGIC;
+  bin.version       = BLE_RESULT_BIN_VERSION;
+  bin.flags         = cam.valid ? BLE_RESULT_FLAG_CAMERA : 0;
+  if (!camWanted) bin.flags |= BLE_RESULT_FLAG_NO_CAMERA;
+  if (!cctWanted) bin.flags |= BLE_RESULT_FLAG_NO_CCT;
+  bin.tempC_x100    = (int16_t) toFixed(temp,     100.0f,   INT16_MIN, INT16_MAX);
+  bin.pH_x1000      = (uint16_t)toFixed(pH,       1000.0f,  0, UINT16_MAX);
+  bin.tdsPpm        = (uint16_t)toFixed(tds,      1.0f,     0, UINT16_MAX);
+  bin.ec_x100       = (uint32_t)toFixed(ec,       100.0f,   0, INT32_MAX);
+  bin.ecSample_x100 = (uint32_t)toFixed(ecSample, 100.0f,   0, INT32_MAX);
+  bin.sg_x10000     = (uint16_t)toFixed(sg,       10000.0f, 0, UINT16_MAX);
+  bin.r = rgb.r;  bin.g = rgb.g;  bin.b = rgb.b;
+  bin.lux_x10       = (uint32_t)toFixed(lux,      10.0f,    0, INT32_MAX);
+  bin.cctK          = cct;
+  bin.camR = cam.valid ? cam.r : 0;
+  bin.camG = cam.valid ? cam.g : 0;
+  bin.camB = cam.valid ? cam.b : 0;
+
+  // Every result goes into the offline history so batches run without a
+  // phone can be synced later ({"cmd":"history","since":N}).
+  uint32_t histSeq = historyAppend(bin);
+  lastTestSeq = histSeq;
+
+  // ...and into the advertising packet, for scanners that never connect.
+  bleAdvertiseResult(histSeq, bin);
+
   // ---- Auto-send via BLE if connected ----
+  // JSON by default; the packed BLEResultV1 if the app asked for it in caps.
   bool sent = false;
   if (isBluetoothConnected()) {
-    sendJsonData(doc);
+    if (blePeerWantsBinary()) {
+      Serial.print("[Test] Binary result: "); Serial.print(sizeof(bin));
+      Serial.print(" B (JSON would be "); Serial.print(measureJson(doc));
+      Serial.println(" B)");
+      sendBinaryData((const uint8_t*)&bin, sizeof(bin));
+    } else {
+      sendJsonData(doc);
+    }
     BLE.poll();   // flush the notification immediately
     sent = true;
   }
 
   // ---- Completion frame ---- (full bar)
-  // "Sent" if a central received the payload; "Standalone" (WARN) otherwise —
-  // not a failure, the device works without a phone connected.
+  // "Sent" if a central received the payload; "Saved #N" (WARN) otherwise —
+  // not a failure, the device works without a phone connected and the result
+  // waits in the history for the next sync.
   const char* sendStatus = sent ? BOOT_OK : BOOT_WARN;
-  drawProgressFrame(TEST_TITLE, sent ? "Sent." : "Standalone.",
+  char savedLabel[20];
+  snprintf(savedLabel, sizeof(savedLabel), "Saved #%lu.", (unsigned long)histSeq);
+  drawProgressFrame(TEST_TITLE, sent ? "Sent." : savedLabel,
                     sendStatus, TEST_STEPS_TOTAL, TEST_STEPS_TOTAL);
   delay(400);
 
+  // Remote (BLE command) tests skip the result pages; the host already has
+  // the result and nobody is at the keypad.
+  if (!testInteractive) {
+    setMenu(&mainMenu);
+    return;
+  }
+
   // ---- Page 1: pH, Temp, TDS, EC ----
   u8g2.clearBuffer();
   u8g2.setFont(u8g2_font_6x10_tf);
@@ -2198,7 +2524,8 @@ void startTest() {
 
   char luxBuf[20], cctBuf[20];
   snprintf(luxBuf, sizeof(luxBuf), "Lux: %.1f", lux);
-  snprintf(cctBuf, sizeof(cctBuf), "CCT: %u K", cct);
+  if (cctWanted) snprintf(cctBuf, sizeof(cctBuf), "CCT: %u K", cct);
+  else           snprintf(cctBuf, sizeof(cctBuf), "CCT: -");
   u8g2.setFont(u8g2_font_5x7_tf);
   u8g2.drawStr(0, 50, luxBuf);
   u8g2.drawStr(0, 58, cctBuf);
@@ -2256,6 +2583,7 @@ void resetRGBCalibration() {
 }
 
 void openTDS()             { setMenu(&TDSMenu); }
+void openMonitor()         { inMonitor = true; }
 void openTDSCalibration()  { tdsCalBegin(); inTDSCal = true; }
 
 void resetTDSCalibration() {
@@ -2347,6 +2675,8 @@ static void drawProgressFrame(const char* title,
     // Colour-code by result: invert box for FAIL/WARN, plain text for OK
     if (strcmp(statusLabel, BOOT_OK) == 0) {
       u8g2.drawStr(0, 34, "[OK]");
+    } else if (strcmp(statusLabel, BOOT_BG) == 0) {
+      u8g2.drawStr(0, 34, "[continues in background]");
     } else if (strcmp(statusLabel, BOOT_WARN) == 0) {
       // Inverted box for WARN
       u8g2.drawBox(0, 25, 40, 11);
@@ -2392,21 +2722,213 @@ static void drawBootFrame(const char* stepLabel,
                     stepsCompleted, BOOT_STEPS_TOTAL);
 }
 
+// ============================================
+// BOOT SEQUENCER
+// ============================================
+//
+// Each subsystem is a BootTask that names the tasks it depends on. setup()
+// repeatedly runs the first task whose dependencies have all finished and
+// polls the camera UART between tasks, so the camera's background bring-up —
+// the one genuinely asynchronous step — interleaves with everything else.
+// The boot screen advances once per finished task, and every task is timed
+// so cold-start cost can be tracked per subsystem across firmware versions
+// (serial table at the end of boot, and the dev diagnostics "Boot" page).
+//
+// The table index doubles as the bit position in bootFaultMask/bootWarnMask.
+//
+//   Camera  — no deps; started first, settles in the background
+//   Display — I2C bus recovery + OLED; anything drawn or on I2C waits on it
+//   Keypad  — plain GPIO matrix
+//   BLE, pH, TDS — independent of each other
+//   RGB     — AS7341 shares the I2C bus with the OLED → after Display
+//   History — RTC + EEPROM ring scan; re-advertises the last result → after BLE
+
+enum BootId {
+  BOOT_CAMERA = 0,
+  BOOT_DISPLAY,
+  BOOT_KEYPAD,
+  BOOT_BLE,
+  BOOT_PH,
+  BOOT_RGB,
+  BOOT_TDS,
+  BOOT_HISTORY,
+  BOOT_TASK_COUNT
+};
+static_assert(BOOT_TASK_COUNT == BOOT_STEPS_TOTAL, "one boot step per BootTask");
+static_assert(BOOT_TASK_COUNT <= 8, "boot dependency and result masks are uint8_t");
+
+#define BOOT_DEP(id)  (uint8_t)(1u << (id))
+
+// Hold on the completed bar just long enough to be seen.
+#define BOOT_DONE_HOLD_MS  150
+
+struct BootTask {
+  const char*   name;        // fault summary / timing table
+  const char*   label;       // boot screen "current step" text
+  uint8_t       deps;        // BOOT_DEP() mask that must be finished first
+  const char* (*run)();      // does the work; returns BOOT_OK/WARN/FAIL/BG
+  const char*   status;      // result, nullptr until run
+  unsigned long startMs;     // millis() when started
+  unsigned long durationMs;  // BG tasks: filled in when they settle
+};
+
+static const char* bootCamera() {
+  // Opens Serial1 and starts the ESP32-CAM bring-up; it can take up to ~8 s
+  // (ESP32 cold-boot grace period) so it is NOT waited for here. camOnline
+  // flips when the handshake completes and reportCameraBringup() folds the
+  // result into the boot summary. Camera is optional: offline is WARN.
+  cameraSensorBegin();
+  return BOOT_BG;
+}
+
+static const char* bootDisplay() {
+  // ---- Free the shared I2C bus BEFORE the first OLED write ----
+  // The OLED (0x3C) and AS7341 (0x39) share one I2C bus. If the previous power
+  // cycle was interrupted mid-read, a slave can still be holding SDA low, which
+  // would hang u8g2.begin()/sendBuffer() below. Recover the bus first so the
+  // loading screen — and every later transaction — starts from a clean bus.
+  i2cBusRecover();
+
+  u8g2.begin();
+
+  // ---- SH1106 2-pixel column fix ----
+  // The SH1106 has 132 columns of GDDRAM but only displays 128.
+  // U8g2 maps framebuffer col 0 → hardware col 2, leaving hardware
+  // cols 0 and 1 unwritten. They retain power-on garbage and appear
+  // as two glitchy pixels on the left edge of the screen.
+  // Fix: write a single zero byte to each of those two columns on
+  // every page via raw I2C, once at startup.
+  const uint8_t SH1106_ADDR = 0x3C;
+  for (uint8_t page = 0; page < 8; page++) {
+    // Set page address, then column address = 0
+    Wire.beginTransmission(SH1106_ADDR);
+    Wire.write(0x00);           // control byte: command stream (Co=0, D/C#=0)
+    Wire.write(0xB0 | page);    // Set Page Address
+    Wire.write(0x00);           // Set Low Column Address  = 0
+    Wire.write(0x10);           // Set High Column Address = 0
+    Wire.endTransmission();
+    // Write 2 zero (black) bytes — clears hardware cols 0 and 1
+    Wire.beginTransmission(SH1106_ADDR);
+    Wire.write(0x40);           // control byte: data stream (Co=0, D/C#=1)
+    Wire.write(0x00);           // col 0 = all pixels off
+    Wire.write(0x00);           // col 1 = all pixels off
+    Wire.endTransmission();
+  }
+  return BOOT_OK;
+}
+
+static const char* bootKeypad() {
+  // keypadInit() is void and will not fail silently — it just won't scan
+  // if the matrix isn't wired. We treat it as always-OK here; hardware
+  // faults surface as "no key response" at runtime.
+  keypadInit();
+  return BOOT_OK;
+}
+
+static const char* bootBLE() {
+  return bluetoothInit() ? BOOT_OK : BOOT_FAIL;
+}
+
+static const char* bootPH() {
+  // pHSensorInit() is void; failure (no hardware) manifests as bad readings.
+  // It always falls back to EEPROM defaults so treat as OK for boot purposes.
+  pHSensorInit();
+  // The DS18B20 is optional: without one, compensation stays at 25 C.
+  tempSensorInit();
+  // The background ADC sampler arms the pH channel here; TDS is armed by its
+  // power gate. Without a free timer the sensors still work (blocking reads),
+  // so that is a warning, not a failure.
+  return analogSamplerInit() ? BOOT_OK : BOOT_WARN;
+}
+
+static const char* bootRGB() {
+  bool ok = colorSensorInit();
+  colorCalPrint();
+  return ok ? BOOT_OK : BOOT_FAIL;
+}
+
+static const char* bootTDS() {
+  // Same as pH — void, defaults to EEPROM; treat as OK for boot.
+  tdsSensorInit();
+  return BOOT_OK;
+}
+
+static const char* bootHistory() {
+  // Result history: start the RTC and find the ring head (one EEPROM scan).
+  // Re-advertise the last stored result so a reboot doesn't blank it. An
+  // empty or unreadable ring is simply a fresh history, so this cannot fail.
+  historyInit();
+  HistoryRecord lastRec;
+  if (historyReadNewest(lastRec)) bleAdvertiseResult(lastRec.seq, lastRec.result);
+  return BOOT_OK;
+}
+
+static BootTask bootTasks[BOOT_TASK_COUNT] = {
+  { "Camera",  "Camera...",     0,                        bootCamera,  nullptr, 0, 0 },
+  { "Display", "Display...",    0,                        bootDisplay, nullptr, 0, 0 },
+  { "Keypad",  "Keypad...",     0,                        bootKeypad,  nullptr, 0, 0 },
+  { "BLE",     "BLE...",        0,                        bootBLE,     nullptr, 0, 0 },
+  { "pH",      "pH Sensor...",  0,                        bootPH,      nullptr, 0, 0 },
+  { "RGB",     "RGB Sensor...", BOOT_DEP(BOOT_DISPLAY),   bootRGB,     nullptr, 0, 0 },
+  { "TDS",     "TDS Sensor...", 0,                        bootTDS,     nullptr, 0, 0 },
+  { "History", "History...",    BOOT_DEP(BOOT_BLE),       bootHistory, nullptr, 0, 0 },
+};
+
+// ---- Boot result masks ----
+// Filled by setup(); the camera bit is set later from loop() once its
+// background bring-up settles (see reportCameraBringup()).
+static uint8_t       bootFaultMask = 0;
+static uint8_t       bootWarnMask  = 0;
+static unsigned long bootMenuAtMs  = 0;   // millis() when the main menu first appeared
+                                         // (includes any time on the fault summary)
+
+/**
+ * Print one row of the boot timing table.
+ */
+static void printBootTaskTiming(const BootTask& t) {
+  char line[56];
+  if (t.status == nullptr) {
+    snprintf(line, sizeof(line), "[Boot]   %-8s (not run)", t.name);
+  } else if (strcmp(t.status, BOOT_BG) == 0) {
+    snprintf(line, sizeof(line), "[Boot]   %-8s t=%5lu  (background)",
+             t.name, t.startMs);
+  } else {
+    snprintf(line, sizeof(line), "[Boot]   %-8s t=%5lu  %5lu ms  %s",
+             t.name, t.startMs, t.durationMs, t.status);
+  }
+  Serial.println(line);
+}
+
+/**
+ * Dev diagnostics page 5: two columns of "name ms" plus time-to-menu, so
+ * cold-start cost can be read off a unit without a serial cable. A camera
+ * still coming up shows "bg".
+ */
+static void drawBootTimingLines() {
+  char buf[16];
+  for (int i = 0; i < BOOT_TASK_COUNT; i++) {
+    const BootTask& t = bootTasks[i];
+    int x = (i % 2) ? 64 : 0;
+    int y = 21 + (i / 2) * 8;
+    if (t.status != nullptr && strcmp(t.status, BOOT_BG) == 0) {
+      snprintf(buf, sizeof(buf), "%-7.7s bg", t.name);
+    } else {
+      snprintf(buf, sizeof(buf), "%-7.7s%5lu", t.name, t.durationMs);
+    }
+    u8g2.drawStr(x, y, buf);
+  }
+  snprintf(buf, sizeof(buf), "Menu %5lums", bootMenuAtMs);
+  u8g2.drawStr((BOOT_TASK_COUNT % 2) ? 64 : 0, 21 + (BOOT_TASK_COUNT / 2) * 8, buf);
+}
+
 /**
  * Show a fault-summary screen after booting with one or more failures.
- * Lists each failed/warned sensor and waits for SELECT to continue.
+ * Lists each failed/warned subsystem and waits for SELECT to continue.
  *
- * faultMask bits (LSB = step 0):
- *   bit 0 = Keypad, bit 1 = Camera, bit 2 = BLE,
- *   bit 3 = pH,     bit 4 = RGB,    bit 5 = TDS
+ * Mask bits are BootId positions (bit 0 = Camera, bit 1 = Display, ...);
  * warnMask uses the same bit positions.
  */
 static void showBootFaultSummary(uint8_t faultMask, uint8_t warnMask) {
-  // Build list of affected sensors
-  static const char* sensorNames[BOOT_STEPS_TOTAL] = {
-    "Keypad", "Camera", "BLE", "pH", "RGB", "TDS"
-  };
-
   u8g2.clearBuffer();
   u8g2.setFont(u8g2_font_6x10_tf);
   u8g2.drawStr(0, 10, "-- Boot Warnings ----");
@@ -2414,16 +2936,16 @@ static void showBootFaultSummary(uint8_t faultMask, uint8_t warnMask) {
 
   u8g2.setFont(u8g2_font_5x7_tf);
   int y = 24;
-  for (int i = 0; i < BOOT_STEPS_TOTAL; i++) {
+  for (int i = 0; i < BOOT_TASK_COUNT; i++) {
     if ((faultMask >> i) & 1) {
       char line[28];
-      snprintf(line, sizeof(line), "[FAIL] %s", sensorNames[i]);
+      snprintf(line, sizeof(line), "[FAIL] %s", bootTasks[i].name);
       u8g2.drawStr(0, y, line);
       y += 10;
       if (y > 54) break;
     } else if ((warnMask >> i) & 1) {
       char line[28];
-      snprintf(line, sizeof(line), "[WARN] %s", sensorNames[i]);
+      snprintf(line, sizeof(line), "[WARN] %s", bootTasks[i].name);
       u8g2.drawStr(0, y, line);
       y += 10;
       if (y > 54) break;
@@ -2434,102 +2956,532 @@ static void showBootFaultSummary(uint8_t faultMask, uint8_t warnMask) {
   u8g2.setFont(u8g2_font_6x10_tf);
   u8g2.sendBuffer();
 
-  // Wait for SELECT
+  // Wait for SELECT (keep the camera bring-up draining Serial1 meanwhile)
   while (scanKey() != 15) {
+    cameraPoll();
     delay(80);
   }
 }
 
+/**
+ * delay() that keeps servicing the camera UART while it is still coming up,
+ * so its READY line isn't lost to an RX overflow during menu idle time.
+ */
+static void pollingDelay(unsigned long ms) {
+  if (!cameraBringupPending()) {
+    delay(ms);
+    return;
+  }
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    cameraPoll();
+    delay(5);
+  }
+}
+
+/**
+ * Once the background camera bring-up settles, fold its result into the boot
+ * summary and timing table and log it. Called every loop(); does nothing
+ * after the first report.
+ */
+static void reportCameraBringup() {
+  static bool reported = false;
+  if (reported || cameraBringupPending()) return;
+  reported = true;
+
+  BootTask& cam = bootTasks[BOOT_CAMERA];
+  cam.status     = camOnline ? BOOT_OK : BOOT_WARN;
+  cam.durationMs = millis() - cam.startMs;
+  if (!camOnline) bootWarnMask |= BOOT_DEP(BOOT_CAMERA);
+
+  Serial.print("[Boot] Camera bring-up settled: ");
+  Serial.print(camOnline ? "ONLINE" : "OFFLINE (WARN)");
+  Serial.print(" at ");
+  Serial.print(millis());
+  Serial.println(" ms.");
+  printBootTaskTiming(cam);
+  if (bootWarnMask) {
+    Serial.print("[Boot] WARNINGS (mask=0x");
+    Serial.print(bootWarnMask, HEX);
+    Serial.println(")");
+  }
+}
+
+/**
+ * Run the boot table in dependency order. Returns the number of tasks run.
+ */
+static uint8_t runBootSequence() {
+  uint8_t     finished   = 0;        // BOOT_DEP() mask of tasks that have run
+  uint8_t     completed  = 0;
+  const char* prevStatus = "";
+
+  while (completed < BOOT_TASK_COUNT) {
+    // First task (in table order) whose dependencies are all satisfied.
+    int next = -1;
+    for (int i = 0; i < BOOT_TASK_COUNT; i++) {
+      if (!(finished & BOOT_DEP(i)) && (bootTasks[i].deps & ~finished) == 0) {
+        next = i;
+        break;
+      }
+    }
+    if (next < 0) {
+      Serial.println("[Boot] ERROR: boot table has a dependency cycle.");
+      break;
+    }
+
+    BootTask& t = bootTasks[next];
+    if (finished & BOOT_DEP(BOOT_DISPLAY)) {
+      drawBootFrame(t.label, prevStatus, completed);
+    }
+
+    t.startMs    = millis();
+    t.status     = t.run();
+    t.durationMs = millis() - t.startMs;
+
+    if (strcmp(t.status, BOOT_FAIL) == 0)      bootFaultMask |= BOOT_DEP(next);
+    else if (strcmp(t.status, BOOT_WARN) == 0) bootWarnMask  |= BOOT_DEP(next);
+
+    finished  |= BOOT_DEP(next);
+    completed++;
+    prevStatus = t.status;
+
+    cameraPoll();   // interleave the camera's background bring-up
+  }
+
+  drawBootFrame("Done.", prevStatus, completed);
+  return completed;
+}
+
 // ============================================
-// SETUP
+// BLE COMMANDS
 // ============================================
+//
+// Host/bench control over DATA_RX. Every write is a JSON object
+//   {"cmd":"<name>","id":<n>, ...params}
+// dispatched through cmdTable below. Each command gets exactly one
+//   {"type":"resp","id":<n>,"cmd":"<name>","ok":true|false, ...}
+// after any data it streams itself (thumbnail, history, caps), so a host can
+// correlate replies by id. Numeric ids only; omitted id echoes as 0.
+//
+// Handlers run from loop(), never from the BLE event handler, so the stack
+// keeps being serviced. The request is the BLE layer's own document (no
+// copy), held until the handler returns: a write that lands meanwhile, in any
+// BLE.poll(), does not overwrite it but is answered
+//   {"type":"resp","id":<n>,"cmd":"<name>","ok":false,"error":"busy"}
+// once the running command has replied, so the host can resend it.
+//
+// Tests requested remotely ("start_test", "run") are queued and run one per
+// loop() pass with the result pages skipped (testInteractive = false); each
+// finished test reports {"type":"run_progress","id","i","n","seq"}. The
+// result itself goes out as usual and is stored in the history.
+
+// Remote test queue ("start_test" = a run of 1).
+static uint16_t      remoteRunsLeft  = 0;
+static uint16_t      remoteRunsTotal = 0;
+static uint32_t      remoteRunId     = 0;
+static unsigned long remoteRunGapMs  = 0;
+static unsigned long remoteRunNextAt = 0;
+
+#define CMD_RUN_MAX         100     // cap on "run" n
+#define CMD_RUN_GAP_MAX_MS  600000  // cap on "run" interval_ms
+
+typedef bool (*CmdHandler)(const JsonDocument& req, JsonDocument& resp);
+
+struct CmdEntry {
+  const char* name;
+  CmdHandler  handler;
+};
 
-void setup() {
-  Serial.begin(9600);
+static bool queueRemoteRuns(uint32_t id, uint16_t n, unsigned long gapMs, JsonDocument& resp) {
+  if (remoteRunsLeft > 0) {
+    resp["error"] = "busy";
+    return false;
+  }
+  remoteRunId     = id;
+  remoteRunsTotal = n;
+  remoteRunsLeft  = n;
+  remoteRunGapMs  = gapMs;
+  remoteRunNextAt = millis();
+  resp["queued"] = n;
+  return true;
+}
 
-  // ---- Free the shared I2C bus BEFORE the first OLED write ----
-  // The OLED (0x3C) and AS7341 (0x39) share one I2C bus. If the previous power
-  // cycle was interrupted mid-read, a slave can still be holding SDA low, which
-  // would hang u8g2.begin()/sendBuffer() below. Recover the bus first so the
-  // loading screen — and every later transaction — starts from a clean bus.
-  i2cBusRecover();
+static bool cmdStartTest(const JsonDocument& req, JsonDocument& resp) {
+  return queueRemoteRuns(req["id"] | 0UL, 1, 0, resp);
+}
 
-  // Display MUST come up before any other init so the loading screen works.
-  u8g2.begin();
+// {"cmd":"run","n":N,"interval_ms":M}
+static bool cmdRun(const JsonDocument& req, JsonDocument& resp) {
+  uint16_t      n   = req["n"] | 1;
+  unsigned long gap = req["interval_ms"] | 0UL;
+  if (n < 1 || n > CMD_RUN_MAX || gap > CMD_RUN_GAP_MAX_MS) {
+    resp["error"] = "range";
+    return false;
+  }
+  return queueRemoteRuns(req["id"] | 0UL, n, gap, resp);
+}
 
-  // ---- SH1106 2-pixel column fix ----
-  // The SH1106 has 132 columns of GDDRAM but only displays 128.
-  // U8g2 maps framebuffer col 0 → hardware col 2, leaving hardware
-  // cols 0 and 1 unwritten. They retain power-on garbage and appear
-  // as two glitchy pixels on the left edge of the screen.
-  // Fix: write a single zero byte to each of those two columns on
-  // every page via raw I2C, once at startup.
-  {
-    const uint8_t SH1106_ADDR = 0x3C;
-    for (uint8_t page = 0; page < 8; page++) {
-      // Set page address, then column address = 0
-      Wire.beginTransmission(SH1106_ADDR);
-      Wire.write(0x00);           // control byte: command stream (Co=0, D/C#=0)
-      Wire.write(0xB0 | page);    // Set Page Address
-      Wire.write(0x00);           // Set Low Column Address  = 0
-      Wire.write(0x10);           // Set High Column Address = 0
-      Wire.endTransmission();
-      // Write 2 zero (black) bytes — clears hardware cols 0 and 1
-      Wire.beginTransmission(SH1106_ADDR);
-      Wire.write(0x40);           // control byte: data stream (Co=0, D/C#=1)
-      Wire.write(0x00);           // col 0 = all pixels off
-      Wire.write(0x00);           // col 1 = all pixels off
-      Wire.endTransmission();
+// {"cmd":"stop"} — abandon the rest of a queued run.
+static bool cmdStop(const JsonDocument& req, JsonDocument& resp) {
+  resp["dropped"] = remoteRunsLeft;
+  remoteRunsLeft = 0;
+  return true;
+}
+
+// ---- Calibration: {"cmd":"cal","sensor":"ph|tds|rgb|cam","step":"begin|capture|save|cancel"} ----
+
+static bool calCapturePH() {
+  return calCapture();
+}
+
+static bool calCaptureTDS() {
+  tdsPowerOnAndSettle();
+  // Standard's actual temperature, as on the calibration screen, so the
+  // stored K is normalised to TDS_TEMP_REF_C like every later reading.
+  bool ok = tdsCalCapture(pHReadTemperature());
+  tdsPowerOff();
+  return ok;
+}
+
+// Same light as the RGB calibration screen: DARK all off, WHITE on-board LED.
+static bool calCaptureRGB() {
+  ColorCalStep before = colorCalStep;
+  illuminatorOff();
+  if (before == COLOR_CAL_DARK) colorOnboardLedOff();
+  else                          colorOnboardLedOn();
+  delay(COLOR_FLASH_SETTLE_MS);
+  colorCalCapture();
+  colorOnboardLedOff();
+  illuminatorOn();
+  return colorCalStep != before;
+}
+
+// Same light as the camera calibration screen / startTest: external LEDs.
+static bool calCaptureCam() {
+  CamCalStep before = camCalStep;
+  colorOnboardLedOff();
+  illuminatorOn();
+  cameraAwaitLightSettle(illuminatorLastChangeMs());
+  camCalCapture();
+  return camCalStep != before;
+}
+
+struct CalTarget {
+  const char* name;
+  void        (*begin)();
+  bool        (*capture)();
+  void        (*save)();
+  void        (*cancel)();
+  const char* (*label)();
+};
+
+static const CalTarget calTargets[] = {
+  { "ph",  calBegin,      calCapturePH,  calSave,      calCancel,      calStepLabel      },
+  { "tds", tdsCalBegin,   calCaptureTDS, tdsCalSave,   tdsCalCancel,   tdsCalStepLabel   },
+  { "rgb", colorCalBegin, calCaptureRGB, colorCalSave, colorCalCancel, colorCalStepLabel },
+  { "cam", camCalBegin,   calCaptureCam, camCalSave,   camCalCancel,   camCalStepLabel   },
+};
+
+static bool cmdCal(const JsonDocument& req, JsonDocument& resp) {
+  const char* sensor = req["sensor"] | "";
+  const char* step   = req["step"]   | "";
+
+  const CalTarget* t = nullptr;
+  for (const CalTarget& c : calTargets) {
+    if (strcmp(sensor, c.name) == 0) { t = &c; break; }
+  }
+  if (t == nullptr) {
+    resp["error"] = "sensor";
+    return false;
+  }
+
+  // Copy the step out before capture() can poll BLE and replace the request.
+  char stepBuf[8];
+  strncpy(stepBuf, step, sizeof(stepBuf) - 1);
+  stepBuf[sizeof(stepBuf) - 1] = '\0';
+
+  // pH only: optional buffer list for the sequence about to begin.
+  if (t->begin == calBegin && strcmp(stepBuf, "begin") == 0 && req["buffers"].is<JsonArrayConst>()) {
+    float buffers[PH_CAL_MAX_POINTS];
+    uint8_t n = 0;
+    for (JsonVariantConst b : req["buffers"].as<JsonArrayConst>()) {
+      if (n == PH_CAL_MAX_POINTS) { n = 0; break; }
+      buffers[n++] = b | -1.0f;
+    }
+    if (!calSetBuffers(buffers, n)) {
+      resp["error"] = "buffers";
+      return false;
     }
   }
 
-  // Keypad uses I2C (PCF8574); init early so scanKey() works in fault screen.
-  // ---- Step 1: Keypad ----
-  drawBootFrame("Keypad...", "", 0);
-  keypadInit();
-  // keypadInit() is void and will not fail silently — it just won't scan
-  // if the PCF8574 isn't present. We treat it as always-OK here; hardware
-  // faults surface as "no key response" at runtime.
-  uint8_t faultMask = 0;
-  uint8_t warnMask  = 0;
-  drawBootFrame("Camera...", BOOT_OK, 1);
-
-  // ---- Step 2: Camera (ESP32-CAM via UART) ----
-  // This step can take up to ~8 s (ESP32 cold-boot grace period).
-  // cameraSensorInit() does its own polling loop, so we just call it.
-  cameraSensorInit();
-  // camOnline is set by cameraSensorInit() — false means offline/not present.
-  // Camera is optional hardware; treat offline as WARN, not FAIL.
-  const char* camStatus = camOnline ? BOOT_OK : BOOT_WARN;
-  if (!camOnline) warnMask |= (1 << 1);
-  drawBootFrame("BLE...", camStatus, 2);
-
-  // ---- Step 3: BLE ----
-  bool bleOk = bluetoothInit();
-  if (!bleOk) faultMask |= (1 << 2);
-  drawBootFrame("pH Sensor...", bleOk ? BOOT_OK : BOOT_FAIL, 3);
-
-  // ---- Step 4: pH Sensor ----
-  pHSensorInit();
-  // pHSensorInit() is void; failure (no hardware) manifests as bad readings.
-  // It always falls back to EEPROM defaults so treat as OK for boot purposes.
-  drawBootFrame("RGB Sensor...", BOOT_OK, 4);
+  bool ok = true;
+  if      (strcmp(stepBuf, "begin")   == 0) t->begin();
+  else if (strcmp(stepBuf, "capture") == 0) ok = t->capture();
+  else if (strcmp(stepBuf, "save")    == 0) t->save();
+  else if (strcmp(stepBuf, "cancel")  == 0) t->cancel();
+  else {
+    resp["error"] = "step";
+    return false;
+  }
+  resp["sensor"] = t->name;
+  resp["state"]  = t->label();
+  return ok;
+}
 
-  // ---- Step 5: RGB / Colour Sensor ----
-  bool colorOk = colorSensorInit();
-  colorCalPrint();
-  if (!colorOk) faultMask |= (1 << 4);
-  drawBootFrame("TDS Sensor...", colorOk ? BOOT_OK : BOOT_FAIL, 5);
+// {"cmd":"set","gain":g,"atime":a,"astep":s,"brightness":b,"brightness2":b2}
+// Any subset; applied immediately, not persisted (calibrate + save for that).
+static bool cmdSet(const JsonDocument& req, JsonDocument& resp) {
+  bool ok = true;
+  if (!req["gain"].isNull()) {
+    int g = req["gain"] | -1;
+    if (g >= 0 && g <= 10) colorSetGain((uint8_t)g);
+    else ok = false;
+  }
+  if (!req["atime"].isNull()) {
+    int a = req["atime"] | -1;
+    if (a >= 0 && a <= 255) colorSetIntegrationTime((uint8_t)a);
+    else ok = false;
+  }
+  if (!req["astep"].isNull()) {
+    long s = req["astep"] | -1L;
+    if (s >= 0 && s <= 65534) colorSetAstep((uint16_t)s);
+    else ok = false;
+  }
+  if (!req["brightness"].isNull()) {
+    int b = req["brightness"] | -1;
+    if (b >= 0 && b <= 255) illuminatorSetBrightness((uint8_t)b);
+    else ok = false;
+  }
+  if (!req["brightness2"].isNull()) {
+    int b = req["brightness2"] | -1;
+    if (b >= 0 && b <= 255) illuminator2SetBrightness((uint8_t)b);
+    else ok = false;
+  }
+  if (!req["mains_hz"].isNull()) {
+    int hz = req["mains_hz"] | -1;   // 50, 60, or 0 to re-detect
+    if (hz < 0 || hz > 255 || !analogSamplerSetMainsHz((uint8_t)hz)) ok = false;
+  }
+  if (!ok) resp["error"] = "range";
+
+  resp["gain"]        = colorGetGain();
+  resp["atime"]       = colorGetIntegrationTime();
+  resp["astep"]       = colorGetAstep();
+  resp["brightness"]  = illuminatorGetBrightness();
+  resp["brightness2"] = illuminator2GetBrightness();
+  resp["mains_hz"]    = analogSamplerMainsHz();
+  return ok;
+}
 
-  // ---- Step 6: TDS Sensor ----
-  tdsSensorInit();
-  // Same as pH — void, defaults to EEPROM; treat as OK for boot.
-  drawBootFrame("Done.", BOOT_OK, 6);
-  delay(400);   // brief pause so user sees the completed bar
+static bool cmdStatus(const JsonDocument& req, JsonDocument& resp) {
+  resp["version"]   = DEVICE_VERSION;
+  resp["uptime_ms"] = millis();
+  resp["cam"]       = cameraBringupPending() ? "starting" : (camOnline ? "ok" : "off");
+  resp["boot_fail"] = bootFaultMask;
+  resp["boot_warn"] = bootWarnMask;
+  resp["last_seq"]  = lastTestSeq;
+  resp["hist_newest"] = historyNewestSeq();
+  resp["hist_count"]  = historyCount();
+  resp["runs_left"]   = remoteRunsLeft;
+  resp["monitor_ms"]  = monitorPeriod();
+  resp["gain"]        = colorGetGain();
+  resp["atime"]       = colorGetIntegrationTime();
+  resp["brightness"]  = illuminatorGetBrightness();
+  return true;
+}
+
+// {"cmd":"thumbnail"} — relay the camera's last frame as a JPEG so a lab
+// tech can see what the camera saw when a result looks odd.
+static bool cmdThumbnail(const JsonDocument& req, JsonDocument& resp) {
+  static const CamThumbSink bleSink = { bleThumbBegin, bleThumbChunk, bleThumbEnd };
+  CamThumbStats st = cameraRelayThumbnail(bleSink);
+  resp["bytes"] = st.bytes;
+  return st.ok;
+}
+
+// {"cmd":"caps","mtu":247,"enc":"bin"} — the app reports its negotiated
+// ATT MTU and (optionally) asks for binary results.
+static bool cmdCaps(const JsonDocument& req, JsonDocument& resp) {
+  bleHandleCaps(req);
+  return true;
+}
+
+// {"cmd":"history","since":N} — bulk-sync stored results after seq N.
+static bool cmdHistory(const JsonDocument& req, JsonDocument& resp) {
+  int sent = historySyncSince(req["since"] | 0UL);
+  resp["sent"] = sent;
+  return sent >= 0;
+}
+
+// {"cmd":"diag","period_ms":P} — start (P > 0) or stop (P = 0) the raw
+// diagnostics stream; always replies with the counters so far.
+static bool cmdDiag(const JsonDocument& req, JsonDocument& resp) {
+  if (!req["period_ms"].isNull()) diagStreamSetPeriod(req["period_ms"] | 0UL);
+  DiagStats st = diagStreamStats();
+  resp["period_ms"]   = diagStreamPeriod();
+  resp["acquired"]    = st.acquired;
+  resp["sent"]        = st.sent;
+  resp["dropped"]     = st.dropped;
+  resp["failed"]      = st.failed;
+  resp["queue_max"]   = st.queueMax;
+  resp["acquire_fps"] = st.acquireFps;
+  resp["send_fps"]    = st.sendFps;
+  resp["color_ms"]    = st.colorMs;
+  resp["notify_ms"]   = st.notifyMs;
+  return true;
+}
+
+// {"cmd":"monitor","period_ms":P} — start (P > 0) or stop (P = 0) continuous
+// monitoring (see Monitor.h); always replies with the current averages.
+static bool cmdMonitor(const JsonDocument& req, JsonDocument& resp) {
+  if (!req["period_ms"].isNull()) monitorSetPeriod(req["period_ms"] | 0UL);
+  MonitorReading m = monitorReading();
+  resp["period_ms"] = monitorPeriod();
+  resp["n"]         = m.samples;
+  resp["notifies"]  = m.notifies;
+  if (m.samples > 0) {
+    resp["pH"]     = m.pH;
+    resp["temp_c"] = m.tempC;
+  }
+  if (m.tdsValid) resp["tds_ppm"] = m.tdsPpm;
+  return true;
+}
+
+// {"cmd":"fields","mask":M} — choose which result fields this peer gets
+// (RESULT_FIELD_* bits); remembered per peer. Without "mask", just reports.
+static bool cmdFields(const JsonDocument& req, JsonDocument& resp) {
+  bool ok = true;
+  if (!req["mask"].isNull()) ok = bleSetResultFields(req["mask"] | (uint16_t)RESULT_FIELDS_ALL);
+  resp["mask"] = bleResultFields();
+  return ok;
+}
+
+// {"cmd":"time","unix":T} — set the RTC used to stamp history records.
+static bool cmdTime(const JsonDocument& req, JsonDocument& resp) {
+  uint32_t t = req["unix"] | 0UL;
+  if (t == 0) {
+    resp["error"] = "unix";
+    return false;
+  }
+  historySetTime(t);
+  return true;
+}
+
+static const CmdEntry cmdTable[] = {
+  { "start_test", cmdStartTest },
+  { "run",        cmdRun       },
+  { "stop",       cmdStop      },
+  { "cal",        cmdCal       },
+  { "set",        cmdSet       },
+  { "status",     cmdStatus    },
+  { "thumbnail",  cmdThumbnail },
+  { "caps",       cmdCaps      },
+  { "history",    cmdHistory   },
+  { "time",       cmdTime      },
+  { "diag",       cmdDiag      },
+  { "monitor",    cmdMonitor   },
+  { "fields",     cmdFields    },
+};
+
+/**
+ * Look up req["cmd"] in cmdTable, run it, and send the correlated "resp".
+ * Writes that aren't a known command are logged and answered with ok:false.
+ */
+static void dispatchCommand(const JsonDocument& req) {
+  // The name is copied: resp would otherwise point into the request
+  // document, which must not outlive the handler.
+  uint32_t id = req["id"] | 0UL;
+  char     name[BLE_CMD_NAME_MAX];
+  strncpy(name, req["cmd"] | "", sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+
+  const CmdEntry* entry = nullptr;
+  for (const CmdEntry& e : cmdTable) {
+    if (strcmp(name, e.name) == 0) { entry = &e; break; }
+  }
+
+  JsonDocument resp;
+  resp["type"] = "resp";
+  resp["id"]   = id;
+  bool ok;
+  if (entry == nullptr) {
+    Serial.print("[Cmd] Unknown command: "); Serial.println(name);
+    resp["cmd"]   = name;
+    resp["error"] = "unknown";
+    ok = false;
+  } else {
+    resp["cmd"] = entry->name;
+    unsigned long start = millis();
+    ok = entry->handler(req, resp);
+    Serial.print("[Cmd] "); Serial.print(entry->name);
+    Serial.print(" id="); Serial.print(id);
+    Serial.print(ok ? " ok, " : " FAILED, ");
+    Serial.print(millis() - start); Serial.println(" ms");
+  }
+  resp["ok"] = ok;
+  sendJsonData(resp);
+}
+
+/**
+ * Answer the commands that arrived while another was pending or running
+ * (bleTakeBusy()) with ok:false, "error":"busy".
+ */
+static void replyBusyCommands() {
+  uint32_t id;
+  char     name[BLE_CMD_NAME_MAX];
+  while (bleTakeBusy(id, name)) {
+    JsonDocument resp;
+    resp["type"]  = "resp";
+    resp["id"]    = id;
+    resp["cmd"]   = name;
+    resp["ok"]    = false;
+    resp["error"] = "busy";
+    sendJsonData(resp);
+  }
+}
+
+/**
+ * Run the next queued remote test if one is due. Called once per loop() pass
+ * so commands ("status", "stop") are still handled between tests.
+ */
+static void serviceRemoteRuns() {
+  if (remoteRunsLeft == 0) return;
+  if ((long)(millis() - remoteRunNextAt) < 0) return;
+
+  uint16_t index = remoteRunsTotal - remoteRunsLeft + 1;
+  unsigned long start = millis();
+  testInteractive = false;
+  startTest();
+  testInteractive = true;
+  remoteRunsLeft--;
+  remoteRunNextAt = millis() + remoteRunGapMs;
+
+  JsonDocument progress;
+  progress["type"] = "run_progress";
+  progress["id"]   = remoteRunId;
+  progress["i"]    = index;
+  progress["n"]    = remoteRunsTotal;
+  progress["seq"]  = lastTestSeq;
+  progress["ms"]   = millis() - start;
+  sendJsonData(progress);
+}
+
+// ============================================
+// SETUP
+// ============================================
+
+void setup() {
+  Serial.begin(9600);
+
+  runBootSequence();
+  unsigned long bootDoneMs = millis();
+  pollingDelay(BOOT_DONE_HOLD_MS);   // brief pause so user sees the completed bar
+
+  // Camera may already have settled during the steps above.
+  reportCameraBringup();
 
   // ---- Fault summary ----
-  if (faultMask || warnMask) {
-    showBootFaultSummary(faultMask, warnMask);
+  if (bootFaultMask || bootWarnMask) {
+    showBootFaultSummary(bootFaultMask, bootWarnMask);
   }
 
   // ---- Serial banner ----
@@ -2537,16 +3489,31 @@ void setup() {
   Serial.print("Device:  "); Serial.println(DEVICE_NAME);
   Serial.print("Type:    "); Serial.println(DEVICE_TYPE);
   Serial.print("Version: "); Serial.println(DEVICE_VERSION);
-  if (faultMask) {
+  if (bootFaultMask) {
     Serial.print("[Boot] FAULTS (mask=0x");
-    Serial.print(faultMask, HEX);
+    Serial.print(bootFaultMask, HEX);
     Serial.println(")");
   }
-  if (warnMask) {
+  if (bootWarnMask) {
     Serial.print("[Boot] WARNINGS (mask=0x");
-    Serial.print(warnMask, HEX);
+    Serial.print(bootWarnMask, HEX);
     Serial.println(")");
   }
+  if (cameraBringupPending()) {
+    Serial.println("[Boot] Camera still starting — result will follow.");
+  }
+
+  bootMenuAtMs = millis();
+  Serial.print("[Boot] ---- Boot timing (fw ");
+  Serial.print(DEVICE_VERSION);
+  Serial.println(") ----");
+  for (int i = 0; i < BOOT_TASK_COUNT; i++) printBootTaskTiming(bootTasks[i]);
+  Serial.print("[Boot] Sequence done: ");
+  Serial.print(bootDoneMs);
+  Serial.println(" ms");
+  Serial.print("[Boot] Time to menu: ");
+  Serial.print(bootMenuAtMs);
+  Serial.println(" ms");
   Serial.println("System initialized");
   Serial.println("========================================");
 
@@ -2558,6 +3525,8 @@ void setup() {
 // ============================================
 
 void loop() {
+  memTrackLowWater();
+
   // ---- Full-screen takeovers ----
   // Each flag is set by its menu callback and cleared by its screen runner.
 
@@ -2607,16 +3576,31 @@ void loop() {
     return;
   }
 
+  if (inMonitor) {
+    runMonitorScreen();
+    return;
+  }
+
   // ---- Normal menu loop ----
   bluetoothUpdate();
+  cameraPoll();   // keep the keep-warm frame cache current / RX drained
+  reportCameraBringup();
 
   if (hasNewData) {
-    JsonDocument receivedData = getReceivedJson();
+    const JsonDocument& receivedData = getReceivedJson();
     Serial.println("Received BLE JSON:");
     serializeJsonPretty(receivedData, Serial);
     Serial.println();
     hasNewData = false;
+
+    dispatchCommand(receivedData);
+    bleReleaseReceived();
   }
+  replyBusyCommands();
+  serviceRemoteRuns();
+  diagStreamService();
+  tempSensorService();
+  monitorService();
 
   drawMenu(u8g2);
 
@@ -2634,10 +3618,14 @@ void loop() {
     } else {
       snprintf(bleLine, sizeof(bleLine), "BT: Advertising...");
     }
+    // Camera status updates here once its background bring-up settles.
+    const char* camLine = cameraBringupPending() ? "Cam:..."
+                        : (camOnline ? "Cam:OK" : "Cam:OFF");
     u8g2.setFont(u8g2_font_5x7_tf);
     // Draw a thin divider then the status text
     u8g2.drawHLine(0, 48, 128);
     u8g2.drawStr(2, 58, bleLine);
+    u8g2.drawStr(92, 58, camLine);
     u8g2.setFont(u8g2_font_6x10_tf);
     u8g2.sendBuffer();
   }
@@ -2674,5 +3662,5 @@ void loop() {
     default: break;
   }
 
-  delay(120);
+  pollingDelay(120);
 }
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include "Bluetooth.h"
+#include "pHSensor.h"   // PH_EEPROM_ADDR: the block above the peer table
+#include <utility/ATT.h>   // ATT.getPeerAddr(): the central's address as bytes
+#include <utility/HCI.h>   // HCI.leConnUpdate(): connection interval changes
+#include <malloc.h>         // mallinfo(): heap in use around JSON documents
 
 // ============================================
 // GLOBALS
@@ -8,19 +12,75 @@ BLESettings bleSettings;
 
 BLEService deviceInfoService(BLE_SERVICE_UUID);
 
-BLEStringCharacteristic manufacturerNameCharacteristic(DEVICE_INFO_CHAR_UUID,  BLERead,   BLE_NAME_MAX_LEN);
-BLEStringCharacteristic modelNumberCharacteristic     (DEVICE_MODEL_CHAR_UUID, BLERead,   BLE_NAME_MAX_LEN);
-BLEStringCharacteristic dataTxCharacteristic          (DATA_TX_CHAR_UUID,      BLERead | BLENotify, JSON_BUFFER_SIZE);
-BLEStringCharacteristic dataRxCharacteristic          (DATA_RX_CHAR_UUID,      BLEWrite,  JSON_BUFFER_SIZE);
+// Plain BLECharacteristic throughout (not BLEStringCharacteristic) so every
+// read and write goes through char/byte buffers and never an Arduino String.
+BLECharacteristic       manufacturerNameCharacteristic(DEVICE_INFO_CHAR_UUID,  BLERead,   BLE_NAME_MAX_LEN);
+BLECharacteristic       modelNumberCharacteristic     (DEVICE_MODEL_CHAR_UUID, BLERead,   BLE_NAME_MAX_LEN);
+BLECharacteristic       dataTxCharacteristic          (DATA_TX_CHAR_UUID,      BLERead | BLENotify, JSON_BUFFER_SIZE);
+BLECharacteristic       dataRxCharacteristic          (DATA_RX_CHAR_UUID,      BLEWrite,  JSON_BUFFER_SIZE);
+BLECharacteristic       thumbTxCharacteristic         (THUMB_TX_CHAR_UUID,     BLERead | BLENotify, BLE_THUMB_PACKET_BYTES);
+BLECharacteristic       diagTxCharacteristic          (DIAG_TX_CHAR_UUID,      BLERead | BLENotify, BLE_DIAG_FRAME_MAX_BYTES);
 
-StaticJsonDocument<JSON_BUFFER_SIZE> lastReceivedJson;
+JsonDocument lastReceivedJson;
 bool hasNewData = false;
+static bool rxHeld = false;   // lastReceivedJson taken by loop() and not yet released
+
+// Commands that arrived while lastReceivedJson was pending or held.
+struct BLEBusyCmd {
+  uint32_t id;
+  char     name[BLE_CMD_NAME_MAX];
+};
+static BLEBusyCmd busyCmds[BLE_BUSY_MAX];
+static uint8_t    busyHead  = 0;
+static uint8_t    busyCount = 0;
+
+BLELinkInfo bleLink = {};
+
+static bool     peerBinary = false;               // caps "enc":"bin"
+static uint16_t peerFields = RESULT_FIELDS_ALL;   // "fields" mask of this peer
+static uint8_t  peerAddr[6];                      // connected central, MSB first
+static bool     peerAddrKnown = false;
+static uint16_t connHandle      = 0;              // HCI handle of that central
+static bool     connHandleKnown = false;
+static uint8_t  fastHolds       = 0;              // open bleRequestFastInterval(true)s
+
+// EEPROM block of remembered per-peer field masks.
+struct BLEPeerFields {
+  uint8_t  addr[6];
+  uint16_t mask;
+};
+
+struct BLEPeerTable {
+  uint8_t       magic;
+  uint8_t       next;                    // slot replaced by the next new peer
+  BLEPeerFields slots[BLE_PEER_SLOTS];   // addr all-zero = unused
+};
+static_assert(BLE_PEER_EEPROM_ADDR + sizeof(BLEPeerTable) <= PH_EEPROM_ADDR,
+              "BLE peer table overruns the pH calibration record");
+
+// NUL-terminated copy of the last DATA_RX write. Static so the receive path
+// never touches the heap.
+static char    rxText[JSON_BUFFER_SIZE + 1];
+static_assert(BLE_MAX_ATT_MTU - 3 <= NOTIFY_PACKET_MAX_BYTES,
+              "NotifyWriter packet buffer smaller than the largest notification");
+
+// Latest advertised result, and whether it still has to reach the radio.
+static BLEAdvResultV1 advResult;
+static bool           advResultValid   = false;
+static bool           advRefreshPending = false;
+
+// Settings the running stack was last configured with; bleApplySettings()
+// diffs bleSettings against this to do the least work per change.
+static BLESettings   appliedSettings;
+static bool          stackRunning   = false;
 
 // ============================================
 // FORWARD DECLARATIONS
 // ============================================
 
 void onDataReceived(BLEDevice central, BLECharacteristic characteristic);
+static void onCentralConnected(BLEDevice central);
+static void onCentralDisconnected(BLEDevice central);
 
 // ============================================
 // SETTINGS MANAGEMENT
@@ -67,10 +127,148 @@ void blePrintSettings() {
 }
 
 // ============================================
-// APPLY SETTINGS  (restarts BLE stack)
+// PER-PEER RESULT FIELDS
 // ============================================
 
-void bleApplySettings() {
+// Highest connection handle HCI can assign (Core spec Vol 4, Part E, 5.4.2).
+static const uint16_t HCI_MAX_CONN_HANDLE = 0x0EFF;
+
+/**
+ * HCI handle of the connected central. BLEDevice keeps it private, so ask ATT
+ * which handle is live. Controllers number handles from 0 upward, so the scan
+ * normally stops at the first step.
+ */
+static bool centralHandle(uint16_t& handle) {
+  for (uint16_t h = 0; h <= HCI_MAX_CONN_HANDLE; h++) {
+    if (!ATT.connected(h)) continue;
+    handle = h;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Address of the connected central, most significant byte first (the order
+ * BLEDevice::address() prints and the peer table stores). BLEDevice only
+ * hands the address out as a heap String, so read the bytes ATT keeps per
+ * connection instead.
+ */
+static bool centralAddress(uint16_t handle, uint8_t out[6]) {
+  uint8_t le[6];
+  if (!ATT.getPeerAddr(handle, le)) return false;
+  for (int i = 0; i < 6; i++) out[i] = le[5 - i];
+  return true;
+}
+
+static void loadPeerTable(BLEPeerTable& table) {
+  EEPROM.get(BLE_PEER_EEPROM_ADDR, table);
+  if (table.magic != BLE_PEER_EEPROM_MAGIC || table.next >= BLE_PEER_SLOTS) {
+    memset(&table, 0, sizeof(table));
+    table.magic = BLE_PEER_EEPROM_MAGIC;
+  }
+}
+
+/** Slot index holding addr, or -1. */
+static int findPeer(const BLEPeerTable& table, const uint8_t addr[6]) {
+  for (int i = 0; i < BLE_PEER_SLOTS; i++) {
+    if (memcmp(table.slots[i].addr, addr, 6) == 0) return i;
+  }
+  return -1;
+}
+
+/** Look up the newly connected peer's mask (ALL if unknown). */
+static void loadPeerFields() {
+  peerFields = RESULT_FIELDS_ALL;
+  if (!peerAddrKnown) return;
+
+  BLEPeerTable table;
+  loadPeerTable(table);
+  int slot = findPeer(table, peerAddr);
+  if (slot >= 0) {
+    peerFields = table.slots[slot].mask;
+    Serial.print("[BLE] Peer field mask 0x"); Serial.println(peerFields, HEX);
+  }
+}
+
+uint16_t bleResultFields() {
+  return bleLink.connected ? peerFields : RESULT_FIELDS_ALL;
+}
+
+bool bleSetResultFields(uint16_t mask) {
+  if (!bleLink.connected || !peerAddrKnown) return false;
+  peerFields = mask & RESULT_FIELDS_ALL;
+
+  BLEPeerTable table;
+  loadPeerTable(table);
+  int slot = findPeer(table, peerAddr);
+  if (slot < 0) {
+    slot = table.next;
+    table.next = (uint8_t)((table.next + 1) % BLE_PEER_SLOTS);
+    memcpy(table.slots[slot].addr, peerAddr, 6);
+  }
+  table.slots[slot].mask = peerFields;
+  EEPROM.put(BLE_PEER_EEPROM_ADDR, table);
+
+  Serial.print("[BLE] Field mask 0x"); Serial.print(peerFields, HEX);
+  Serial.print(" saved for "); Serial.println(bleLink.peerAddress);
+  return true;
+}
+
+// ============================================
+// ADVERTISED RESULT
+// ============================================
+
+/**
+ * Load the advertised result into the stack's advertising data. Takes
+ * effect on the next BLE.advertise().
+ */
+static void loadAdvertisedResult() {
+  if (!advResultValid) return;
+  BLE.setManufacturerData(BLE_ADV_COMPANY_ID, (const uint8_t*)&advResult, sizeof(advResult));
+}
+
+/** Restart advertising with the current advertised result. */
+static void refreshAdvertising() {
+  loadAdvertisedResult();
+  advRefreshPending = false;
+  if (!bleSettings.advertisingEnabled) return;
+  BLE.stopAdvertise();
+  BLE.advertise();
+}
+
+void bleAdvertiseResult(uint32_t seq, const BLEResultV1& result) {
+  advResult.version    = BLE_ADV_RESULT_VERSION;
+  advResult.seq        = seq;
+  advResult.pH_x1000   = result.pH_x1000;
+  advResult.sg_x10000  = result.sg_x10000;
+  advResult.tempC_x100 = result.tempC_x100;
+  advResult.tdsPpm     = result.tdsPpm;
+  advResult.r = result.r;  advResult.g = result.g;  advResult.b = result.b;
+  advResult.flags = 0;
+  if (result.flags & BLE_RESULT_FLAG_CAMERA) advResult.flags |= BLE_ADV_FLAG_CAMERA;
+  if (result.sg_x10000 == 0)                 advResult.flags |= BLE_ADV_FLAG_SG_FAULT;
+  advResult.camR = result.camR;  advResult.camG = result.camG;  advResult.camB = result.camB;
+  advResultValid = true;
+
+  if (isBluetoothConnected()) {
+    advRefreshPending = true;   // applied by bluetoothUpdate() on disconnect
+    Serial.print("[BLE] Result seq "); Serial.print(seq);
+    Serial.println(" will be advertised after disconnect.");
+  } else {
+    refreshAdvertising();
+    Serial.print("[BLE] Advertising result seq "); Serial.println(seq);
+  }
+}
+
+// ============================================
+// APPLY SETTINGS
+// ============================================
+
+/**
+ * Full teardown and re-init of the BLE stack. Only needed when the stack
+ * isn't running (failed begin); every settings field can be applied live.
+ */
+static void restartStack() {
   BLEDevice central = BLE.central();
   if (central && central.connected()) {
     central.disconnect();
@@ -79,22 +277,27 @@ void bleApplySettings() {
 
   BLE.stopAdvertise();
   BLE.end();
+  bleLink.connected = false;   // no disconnect event once the stack is down
   delay(100);
 
   if (!BLE.begin()) {
     Serial.println("[BLE] Failed to restart BLE after settings change!");
+    stackRunning = false;
     return;
   }
 
   BLE.setDeviceName(bleSettings.localName);
   BLE.setLocalName(bleSettings.localName);
   BLE.setAdvertisedService(deviceInfoService);
+  BLE.setConnectionInterval(BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX);
 
   // Must re-add characteristics — BLE.end() deregisters them
   deviceInfoService.addCharacteristic(manufacturerNameCharacteristic);
   deviceInfoService.addCharacteristic(modelNumberCharacteristic);
   deviceInfoService.addCharacteristic(dataTxCharacteristic);
   deviceInfoService.addCharacteristic(dataRxCharacteristic);
+  deviceInfoService.addCharacteristic(thumbTxCharacteristic);
+  deviceInfoService.addCharacteristic(diagTxCharacteristic);
 
   manufacturerNameCharacteristic.writeValue(bleSettings.manufacturer);
   modelNumberCharacteristic.writeValue(bleSettings.modelNumber);
@@ -102,9 +305,13 @@ void bleApplySettings() {
   // Must re-add the service and re-register the RX handler
   BLE.addService(deviceInfoService);
   dataRxCharacteristic.setEventHandler(BLEWritten, onDataReceived);
+  BLE.setEventHandler(BLEConnected,    onCentralConnected);
+  BLE.setEventHandler(BLEDisconnected, onCentralDisconnected);
 
   // BLE.setTxPower(bleSettings.txPower); // uncomment if your core supports it
 
+  loadAdvertisedResult();   // BLE.end() cleared the advertising data
+
   if (bleSettings.advertisingEnabled) {
     BLE.advertise();
     Serial.println("[BLE] Advertising restarted with new settings.");
@@ -112,6 +319,71 @@ void bleApplySettings() {
     Serial.println("[BLE] Advertising disabled by user setting.");
   }
 
+  appliedSettings = bleSettings;
+  stackRunning    = true;
+  blePrintSettings();
+}
+
+void bleApplySettings() {
+  if (!stackRunning) {
+    restartStack();
+    return;
+  }
+
+  unsigned long start = millis();
+  const BLESettings& was = appliedSettings;
+  bool restartAdvertising = false;
+
+  // Read-only characteristic values: just rewrite them.
+  if (strcmp(was.manufacturer, bleSettings.manufacturer) != 0) {
+    manufacturerNameCharacteristic.writeValue(bleSettings.manufacturer);
+    Serial.println("[BLE] Manufacturer updated live.");
+  }
+  if (strcmp(was.modelNumber, bleSettings.modelNumber) != 0) {
+    modelNumberCharacteristic.writeValue(bleSettings.modelNumber);
+    Serial.println("[BLE] Model number updated live.");
+  }
+
+  if (was.txPower != bleSettings.txPower) {
+    // BLE.setTxPower(bleSettings.txPower); // uncomment if your core supports it
+    Serial.println("[BLE] TX power stored (no TX power API in this core).");
+  }
+
+  // The GAP name changes at once; the advertised name needs a new
+  // advertising set.
+  if (strcmp(was.localName, bleSettings.localName) != 0) {
+    BLE.setDeviceName(bleSettings.localName);
+    BLE.setLocalName(bleSettings.localName);
+    restartAdvertising = true;
+  }
+
+  if (was.advertisingEnabled != bleSettings.advertisingEnabled) {
+    if (bleSettings.advertisingEnabled) {
+      restartAdvertising = true;
+    } else {
+      // "Off" means off: stop advertising and drop the current central.
+      BLE.stopAdvertise();
+      BLEDevice central = BLE.central();
+      if (central && central.connected()) {
+        central.disconnect();
+      }
+      Serial.println("[BLE] Advertising disabled by user setting.");
+    }
+  }
+
+  if (restartAdvertising && bleSettings.advertisingEnabled) {
+    if (isBluetoothConnected()) {
+      advRefreshPending = true;   // not advertising while connected
+      Serial.println("[BLE] Advertising change applies after disconnect.");
+    } else {
+      refreshAdvertising();
+      Serial.println("[BLE] Advertising restarted with new settings.");
+    }
+  }
+
+  appliedSettings = bleSettings;
+  Serial.print("[BLE] Settings applied live in ");
+  Serial.print(millis() - start); Serial.println(" ms.");
   blePrintSettings();
 }
 
@@ -136,22 +408,32 @@ bool bluetoothInit() {
   BLE.setDeviceName(bleSettings.localName);   // GAP Device Name — full name, read after connect
   BLE.setLocalName(bleSettings.localName);    // Advertisement local name — may be truncated by stack
   BLE.setAdvertisedService(deviceInfoService);
+  BLE.setConnectionInterval(BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX);
 
   deviceInfoService.addCharacteristic(manufacturerNameCharacteristic);
   deviceInfoService.addCharacteristic(modelNumberCharacteristic);
   deviceInfoService.addCharacteristic(dataTxCharacteristic);
   deviceInfoService.addCharacteristic(dataRxCharacteristic);
+  deviceInfoService.addCharacteristic(thumbTxCharacteristic);
+  deviceInfoService.addCharacteristic(diagTxCharacteristic);
 
   manufacturerNameCharacteristic.writeValue(bleSettings.manufacturer);
   modelNumberCharacteristic.writeValue(bleSettings.modelNumber);
 
   BLE.addService(deviceInfoService);
   dataRxCharacteristic.setEventHandler(BLEWritten, onDataReceived);
+  BLE.setEventHandler(BLEConnected,    onCentralConnected);
+  BLE.setEventHandler(BLEDisconnected, onCentralDisconnected);
 
   if (bleSettings.advertisingEnabled) {
     BLE.advertise();
     Serial.println("[BLE] Advertising started.");
   }
+  bleLink.attMtu          = BLE_LEGACY_ATT_MTU;
+  bleLink.connIntervalMin = BLE_CONN_INTERVAL_MIN;
+  bleLink.connIntervalMax = BLE_CONN_INTERVAL_MAX;
+  appliedSettings = bleSettings;
+  stackRunning    = true;
   return true;
 }
 
@@ -162,81 +444,346 @@ bool bluetoothInit() {
 void bluetoothUpdate() {
   BLE.poll();   // flush TX notifications and process incoming events
 
-  BLEDevice central = BLE.central();
-  if (central && !central.connected()) {
-    Serial.println("[BLE] Central disconnected.");
-  }
+  // Connection state itself is tracked by the BLEConnected/BLEDisconnected
+  // handlers; only deferred advertising work is left for here.
+  if (!bleLink.connected && advRefreshPending) refreshAdvertising();
 }
 
 // ============================================
 // SEND
 // ============================================
 
+/**
+ * Notify one packet. The pacing happens inside ArduinoBLE: writeValue() ->
+ * ATT handleNotify() -> HCI sendAclPkt() waits until the controller has a
+ * free ACL buffer, so back-to-back calls run at the link's rate. A 0 return
+ * means no central is connected and subscribed, which retrying cannot fix.
+ */
+static bool notifyPaced(BLECharacteristic& chr, const uint8_t* pkt, size_t len) {
+  return chr.writeValue(pkt, (int)len) != 0;
+}
+
+// ============================================
+// JSON HEAP
+// ============================================
+
+// JsonDocument (ArduinoJson 7) takes its pool from the heap, so every reply,
+// notification and parsed command allocates. The heap in use is sampled while
+// each document is alive; the largest sample and the document's type (or
+// command name) are kept for dev page 6.
+static size_t jsonHeapPeak = 0;
+static char   jsonHeapPath[BLE_CMD_NAME_MAX] = "";
+
+static void sampleJsonHeap(const char* path) {
+  struct mallinfo mi = mallinfo();
+  if ((size_t)mi.uordblks <= jsonHeapPeak) return;
+  jsonHeapPeak = (size_t)mi.uordblks;
+  strncpy(jsonHeapPath, path, sizeof(jsonHeapPath) - 1);
+  jsonHeapPath[sizeof(jsonHeapPath) - 1] = '\0';
+}
+
+size_t bleJsonHeapPeak(const char** path) {
+  if (path) *path = jsonHeapPath;
+  return jsonHeapPeak;
+}
+
 void sendJsonData(const JsonDocument& jsonDoc) {
+  sampleJsonHeap(jsonDoc["type"] | "?");
   if (!isBluetoothConnected()) {
     Serial.println("[BLE] Not connected — cannot send.");
     return;
   }
 
-  String jsonString;
-  serializeJson(jsonDoc, jsonString);
-  Serial.print("[BLE] Sending ("); Serial.print(jsonString.length()); Serial.println(" bytes):");
-  Serial.println(jsonString);
+  Serial.print("[BLE] Sending ("); Serial.print(measureJson(jsonDoc)); Serial.println(" bytes):");
+  serializeJson(jsonDoc, Serial);
+  Serial.println();
 
-  // ArduinoBLE does not auto-chunk large notify payloads.
-  // Manually split into 20-byte packets so iOS receives everything.
-  const int chunkSize = 20;
-  int totalLength = jsonString.length();
-  int offset = 0;
+  unsigned long start = millis();
+  NotifyWriter writer = dataTxWriter();
+  serializeJson(jsonDoc, writer);
+  writer.finish(start);
+}
 
-  while (offset < totalLength) {
-    int remaining = totalLength - offset;
-    int len = remaining < chunkSize ? remaining : chunkSize;
-    String chunk = jsonString.substring(offset, offset + len);
-    dataTxCharacteristic.writeValue(chunk);
-    offset += len;
-    delay(10); // give iOS time to process each notification
+void sendBinaryData(const uint8_t* data, size_t len) {
+  if (!isBluetoothConnected()) {
+    Serial.println("[BLE] Not connected — cannot send.");
+    return;
   }
+  Serial.print("[BLE] Sending binary ("); Serial.print(len); Serial.println(" bytes).");
 
-  Serial.println("[BLE] Send complete.");
+  unsigned long start = millis();
+  NotifyWriter writer = dataTxWriter();
+  writer.write(data, len);
+  writer.finish(start);
 }
 
-
-void sendMessage(const String& message) {
+void sendMessage(const char* message) {
   if (!isBluetoothConnected()) return;
-  StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+  JsonDocument doc;
   doc["type"] = "message";
   doc["data"] = message;
   sendJsonData(doc);
 }
 
+void bleHandleCaps(const JsonDocument& caps) {
+  uint16_t mtu = caps["mtu"] | (uint16_t)BLE_LEGACY_ATT_MTU;
+  if (mtu < BLE_LEGACY_ATT_MTU) mtu = BLE_LEGACY_ATT_MTU;
+  if (mtu > BLE_MAX_ATT_MTU) {
+    Serial.print("[BLE] Reported MTU "); Serial.print(mtu);
+    Serial.print(" above this stack's limit; using "); Serial.println(BLE_MAX_ATT_MTU);
+    mtu = BLE_MAX_ATT_MTU;
+  }
+  bleLink.attMtu = mtu;
+  peerBinary = (strcmp(caps["enc"] | "json", "bin") == 0);
+
+  uint16_t payload = bleLink.attMtu - 3;
+  if (payload > JSON_BUFFER_SIZE) payload = JSON_BUFFER_SIZE;
+  Serial.print("[BLE] Central caps: MTU "); Serial.print(bleLink.attMtu);
+  Serial.print(" -> "); Serial.print(payload); Serial.print(" B per notification, ");
+  Serial.println(peerBinary ? "binary results." : "JSON results.");
+
+  JsonDocument doc;
+  doc["type"]    = "caps";
+  doc["mtu"]     = bleLink.attMtu;
+  doc["payload"] = payload;
+  doc["enc"]     = peerBinary ? "bin" : "json";
+  if (peerBinary) doc["bin_version"] = BLE_RESULT_BIN_VERSION;
+  sendJsonData(doc);
+}
+
+bool blePeerWantsBinary() {
+  return peerBinary;
+}
+
+// ============================================
+// CONNECTION INTERVAL
+// ============================================
+
+/** Request a new interval range on the live link and record it in bleLink. */
+static void requestInterval(uint16_t minInterval, uint16_t maxInterval) {
+  if (!isBluetoothConnected() || !connHandleKnown) return;
+  int status = HCI.leConnUpdate(connHandle, minInterval, maxInterval, 0,
+                                BLE_CONN_SUPERVISION_TIMEOUT);
+  Serial.print("[BLE] Connection interval "); Serial.print(minInterval * 1.25f, 1);
+  Serial.print('-'); Serial.print(maxInterval * 1.25f, 1);
+  if (status != 0) {
+    Serial.print(" ms refused (HCI status "); Serial.print(status);
+    Serial.println(").");
+    return;
+  }
+  Serial.println(" ms requested.");
+  bleLink.connIntervalMin = minInterval;
+  bleLink.connIntervalMax = maxInterval;
+}
+
+void bleRequestFastInterval(bool fast) {
+  if (fast) {
+    if (fastHolds++ == 0) requestInterval(BLE_CONN_INTERVAL_FAST_MIN, BLE_CONN_INTERVAL_FAST_MAX);
+  } else if (fastHolds > 0) {
+    if (--fastHolds == 0) requestInterval(BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX);
+  }
+}
+
+// ============================================
+// CAMERA THUMBNAIL RELAY
+// ============================================
+
+static uint16_t thumbSeq           = 0;
+static uint16_t thumbNotifications = 0;
+
+static bool thumbNotify(const uint8_t* pkt, size_t len) {
+  if (!notifyPaced(thumbTxCharacteristic, pkt, len)) return false;
+  thumbNotifications++;
+  return true;
+}
+
+bool bleThumbBegin(uint32_t totalBytes) {
+  if (!isBluetoothConnected() || !thumbTxCharacteristic.subscribed()) {
+    Serial.println("[BLE] Thumbnail: no subscriber on the thumbnail characteristic.");
+    return false;
+  }
+  thumbSeq           = 0;
+  thumbNotifications = 0;
+
+  uint8_t pkt[6] = { 0x00, 0x00,
+                     (uint8_t)(totalBytes),       (uint8_t)(totalBytes >> 8),
+                     (uint8_t)(totalBytes >> 16), (uint8_t)(totalBytes >> 24) };
+  if (!thumbNotify(pkt, sizeof(pkt))) return false;
+  thumbSeq = 1;
+  bleRequestFastInterval(true);   // given back in bleThumbEnd()
+  return true;
+}
+
+bool bleThumbChunk(const uint8_t* data, size_t len) {
+  uint8_t pkt[BLE_THUMB_PACKET_BYTES];
+  const size_t payload = BLE_THUMB_PACKET_BYTES - 2;
+
+  for (size_t off = 0; off < len; off += payload) {
+    size_t n = (len - off < payload) ? (len - off) : payload;
+    if (thumbSeq == 0xFFFF) return false;   // JPEG larger than the format allows
+    pkt[0] = (uint8_t)(thumbSeq);
+    pkt[1] = (uint8_t)(thumbSeq >> 8);
+    memcpy(pkt + 2, data + off, n);
+    if (!thumbNotify(pkt, n + 2)) return false;
+    thumbSeq++;
+  }
+  return true;
+}
+
+void bleThumbEnd(bool ok) {
+  if (isBluetoothConnected() && thumbTxCharacteristic.subscribed()) {
+    uint8_t pkt[3] = { 0xFF, 0xFF, (uint8_t)(ok ? 1 : 0) };
+    thumbNotify(pkt, sizeof(pkt));
+  }
+  bleRequestFastInterval(false);
+  Serial.print("[BLE] Thumbnail: ");
+  Serial.print(thumbNotifications);
+  Serial.println(" notifications.");
+}
+
+// ============================================
+// DIAGNOSTICS STREAM
+// ============================================
+
+bool bleDiagSubscribed() {
+  return isBluetoothConnected() && diagTxCharacteristic.subscribed();
+}
+
+bool bleDiagNotify(const uint8_t* frame, size_t len) {
+  return diagTxCharacteristic.writeValue(frame, (int)len) != 0;
+}
+
 // ============================================
 // STATUS
 // ============================================
 
 bool isBluetoothConnected() {
+  return bleLink.connected;
+}
+
+int bleReadRssi() {
+  if (!bleLink.connected) return 0;
   BLEDevice central = BLE.central();
-  return central && central.connected();
+  return central ? central.rssi() : 0;
 }
 
-JsonDocument getReceivedJson() {
+// ============================================
+// CONNECTION EVENTS
+// ============================================
+
+static void onCentralConnected(BLEDevice central) {
+  unsigned long now = millis();
+  bleLink.connected   = true;
+  bleLink.connectedAt = now;
+  bleLink.connects++;
+  bleLink.attMtu      = BLE_LEGACY_ATT_MTU;   // until the central sends caps
+  peerBinary          = false;
+  busyCount           = 0;                    // replies owed to the last central
+  connHandleKnown     = centralHandle(connHandle);
+  peerAddrKnown       = connHandleKnown && centralAddress(connHandle, peerAddr);
+  fastHolds           = 0;
+  bleLink.connIntervalMin = BLE_CONN_INTERVAL_MIN;   // what ArduinoBLE asks for on connect
+  bleLink.connIntervalMax = BLE_CONN_INTERVAL_MAX;
+  if (peerAddrKnown) {
+    snprintf(bleLink.peerAddress, sizeof(bleLink.peerAddress),
+             "%02x:%02x:%02x:%02x:%02x:%02x",
+             peerAddr[0], peerAddr[1], peerAddr[2], peerAddr[3], peerAddr[4], peerAddr[5]);
+  } else {
+    bleLink.peerAddress[0] = '\0';
+  }
+  loadPeerFields();
+
+  Serial.print("[BLE] Central connected: "); Serial.print(bleLink.peerAddress);
+  if (bleLink.disconnectedAt != 0) {
+    Serial.print(" ("); Serial.print(now - bleLink.disconnectedAt);
+    Serial.print(" ms after the last disconnect)");
+  }
+  Serial.println(".");
+}
+
+static void onCentralDisconnected(BLEDevice central) {
+  bleLink.connected      = false;
+  connHandleKnown        = false;
+  fastHolds              = 0;
+  bleLink.disconnectedAt = millis();
+  bleLink.disconnects++;
+  Serial.print("[BLE] Central disconnected after ");
+  Serial.print(bleLink.disconnectedAt - bleLink.connectedAt);
+  Serial.println(" ms.");
+}
+
+const JsonDocument& getReceivedJson() {
   hasNewData = false;
+  rxHeld     = true;
   return lastReceivedJson;
 }
 
+void bleReleaseReceived() {
+  rxHeld = false;
+}
+
+bool bleTakeBusy(uint32_t& id, char name[BLE_CMD_NAME_MAX]) {
+  if (busyCount == 0) return false;
+  const BLEBusyCmd& c = busyCmds[busyHead];
+  id = c.id;
+  memcpy(name, c.name, BLE_CMD_NAME_MAX);
+  busyHead = (uint8_t)((busyHead + 1) % BLE_BUSY_MAX);
+  busyCount--;
+  return true;
+}
+
+/**
+ * Record the id and name of a write that arrived while the previous command
+ * was pending, for a busy reply. Only those two fields are parsed (filtered),
+ * which keeps the document's heap pool small.
+ */
+static void recordBusy(const char* text, size_t len) {
+  if (busyCount == BLE_BUSY_MAX) {
+    Serial.println("[BLE] Command dropped: busy queue full.");
+    return;
+  }
+  JsonDocument filter;
+  filter["id"]  = true;
+  filter["cmd"] = true;
+  JsonDocument doc;
+  deserializeJson(doc, text, len, DeserializationOption::Filter(filter));
+  sampleJsonHeap("busy");
+
+  BLEBusyCmd& c = busyCmds[(busyHead + busyCount) % BLE_BUSY_MAX];
+  c.id = doc["id"] | 0UL;
+  strncpy(c.name, doc["cmd"] | "", BLE_CMD_NAME_MAX - 1);
+  c.name[BLE_CMD_NAME_MAX - 1] = '\0';
+  busyCount++;
+  Serial.print("[BLE] Command "); Serial.print(c.name);
+  Serial.print(" id="); Serial.print(c.id);
+  Serial.println(" arrived while busy.");
+}
+
 // ============================================
 // EVENT HANDLER
 // ============================================
 
 void onDataReceived(BLEDevice central, BLECharacteristic characteristic) {
-  String receivedData = dataRxCharacteristic.value();
-  Serial.print("[BLE] Received: "); Serial.println(receivedData);
+  int len = dataRxCharacteristic.valueLength();
+  if (len > JSON_BUFFER_SIZE) len = JSON_BUFFER_SIZE;
+
+  // The pending document may point into rxText (raw_message), so a write
+  // turned away as busy is parsed straight from the characteristic.
+  if (hasNewData || rxHeld) {
+    recordBusy((const char*)dataRxCharacteristic.value(), (size_t)len);
+    return;
+  }
 
-  DeserializationError error = deserializeJson(lastReceivedJson, receivedData);
+  memcpy(rxText, dataRxCharacteristic.value(), len);
+  rxText[len] = '\0';
+  Serial.print("[BLE] Received: "); Serial.println(rxText);
+
+  DeserializationError error = deserializeJson(lastReceivedJson, (const char*)rxText, (size_t)len);
   if (error) {
     lastReceivedJson.clear();
     lastReceivedJson["type"] = "raw_message";
-    lastReceivedJson["data"] = receivedData;
+    lastReceivedJson["data"] = (const char*)rxText;   // rxText lives until the next write
   }
+  sampleJsonHeap(lastReceivedJson["cmd"] | "rx");
   hasNewData = true;
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include <ArduinoBLE.h>
 #include <ArduinoJson.h>
 #include <EEPROM.h>
+#include "NotifyWriter.h"
 
 // ============================================
 // BLE SERVICE & CHARACTERISTIC UUIDS
@@ -14,6 +15,11 @@
 #define DEVICE_MODEL_CHAR_UUID "2A24"   // Model Number
 #define DATA_TX_CHAR_UUID      "2A37"   // Data TX (notify)
 #define DATA_RX_CHAR_UUID      "2A38"   // Data RX (write)
+#define THUMB_TX_CHAR_UUID     "2A3A"   // Camera thumbnail relay (notify)
+#define DIAG_TX_CHAR_UUID      "2A3B"   // Live diagnostics frames (notify)
+
+// Value size of the diagnostics characteristic (see DiagStream.h).
+#define BLE_DIAG_FRAME_MAX_BYTES  64
 
 // ============================================
 // DEFAULTS  (used when EEPROM has no valid data)
@@ -27,6 +33,160 @@
 
 #define JSON_BUFFER_SIZE  512
 
+// Commands that arrive while the previous one is still pending or running
+// are not parsed (that would overwrite it) but remembered as id + name, up to
+// BLE_BUSY_MAX of them, and answered "busy" by the dispatcher afterwards.
+#define BLE_BUSY_MAX      4
+#define BLE_CMD_NAME_MAX  16     // longest command name kept, incl. NUL
+
+// ============================================
+// JSON TX  (sendJsonData)
+// ============================================
+//
+// Each notification carries up to (ATT MTU - 3) bytes of the serialized JSON.
+// ArduinoBLE negotiates the MTU but exposes no accessor for it, so the app
+// reports the value it negotiated with {"cmd":"caps","mtu":<n>} right after
+// connecting. Centrals that never send caps stay on the legacy 23-byte MTU
+// (20-byte payloads), which every stack accepts. The payload is also capped
+// at JSON_BUFFER_SIZE, the DATA_TX characteristic's value size.
+//
+// The reported MTU is not trusted blindly: ATT silently truncates a
+// notification longer than the negotiated MTU, so a report above what this
+// side can have agreed to would corrupt every payload. ArduinoBLE offers at
+// most its controller's LE ACL buffer less the 9 header bytes in the MTU
+// exchange, so the negotiated value can never exceed that. BLE_MAX_ATT_MTU
+// is a conservative bound below it for the UNO R4 WiFi, and reports are
+// clamped to it.
+//
+// Pacing: ArduinoBLE's writeValue() does not fail when the controller is
+// busy. It waits inside HCI sendAclPkt() until a controller buffer frees up,
+// so the link itself paces consecutive notifications. writeValue() returns
+// 0 only when no central is connected and subscribed.
+#define BLE_LEGACY_ATT_MTU        23
+#define BLE_MAX_ATT_MTU           185
+
+// Connection interval, in 1.25 ms units. The relaxed range is the idle
+// preference, set before advertising (ArduinoBLE requests it on connect).
+// Bulk transfers (history sync, thumbnail relay, diagnostics stream) ask for
+// the fast interval with bleRequestFastInterval() so more connection events
+// per second carry notifications, and the relaxed one is requested again
+// when the last of them ends. Both are requests: the central decides and the
+// stack never reports what it chose, and a controller or central that
+// refuses the update simply leaves the link where it was. The values follow
+// Apple's accessory rules (min >= 15 ms; min + 15 ms <= max unless both are
+// 15 ms), which Android also accepts.
+#define BLE_CONN_INTERVAL_MIN        24    // 30 ms
+#define BLE_CONN_INTERVAL_MAX        48    // 60 ms
+#define BLE_CONN_INTERVAL_FAST_MIN   12    // 15 ms
+#define BLE_CONN_INTERVAL_FAST_MAX   12
+#define BLE_CONN_SUPERVISION_TIMEOUT 400   // 10 ms units (4 s)
+
+// ============================================
+// BINARY RESULT ENCODING
+// ============================================
+//
+// A central that sends {"cmd":"caps","enc":"bin"} receives test results as a
+// packed BLEResultV1 on DATA_TX instead of JSON (~31 bytes vs ~350). Other
+// messages (caps reply, test_started, ...) stay JSON, so the app tells them
+// apart by the first byte: '{' for JSON, BLE_RESULT_BIN_MAGIC for binary.
+// All multi-byte fields are little-endian. Bump BLE_RESULT_BIN_VERSION and
+// add a new struct whenever the layout changes; never edit V1 in place.
+#define BLE_RESULT_BIN_MAGIC    0xB1
+#define BLE_RESULT_BIN_VERSION  1
+
+#define BLE_RESULT_FLAG_CAMERA      0x01   // cam* fields are valid
+#define BLE_RESULT_FLAG_NO_CAMERA   0x02   // camera step skipped (peer's field mask)
+#define BLE_RESULT_FLAG_NO_CCT      0x04   // cctK not measured (peer's field mask)
+
+struct __attribute__((packed)) BLEResultV1 {
+  uint8_t  magic;           // BLE_RESULT_BIN_MAGIC
+  uint8_t  version;         // BLE_RESULT_BIN_VERSION
+  uint8_t  flags;           // BLE_RESULT_FLAG_*
+  int16_t  tempC_x100;      // °C × 100
+  uint16_t pH_x1000;        // pH × 1000
+  uint16_t tdsPpm;          // ppm
+  uint32_t ec_x100;         // cell EC, µS/cm × 100
+  uint32_t ecSample_x100;   // neat-sample EC, µS/cm × 100
+  uint16_t sg_x10000;       // specific gravity × 10000 (0 = calibration fault)
+  uint8_t  r, g, b;         // AS7341 normalised colour
+  uint32_t lux_x10;         // lux × 10
+  uint16_t cctK;            // colour temperature, K
+  uint8_t  camR, camG, camB;
+};
+static_assert(sizeof(BLEResultV1) == 31, "BLEResultV1 wire layout changed");
+
+// ============================================
+// RESULT FIELDS
+// ============================================
+//
+// A central can ask for a subset of the JSON test result with
+// {"cmd":"fields","mask":M}. The mask is remembered per peer address (up to
+// BLE_PEER_SLOTS peers, oldest entry replaced) and reloaded on reconnect;
+// peers that never set one get RESULT_FIELDS_ALL. When the connected peer
+// doesn't want CCT or camera data, startTest() skips computing them too (the
+// camera step is the slow one), and the binary/history record says so with
+// BLE_RESULT_FLAG_NO_CCT / BLE_RESULT_FLAG_NO_CAMERA rather than holding a
+// zero that looks like a measurement. The cheap fields are always measured
+// and stored; for them the mask only trims the JSON.
+// Standalone tests (nobody connected) always measure everything.
+// Phones that use rotating private addresses look like a new peer each time
+// and simply fall back to ALL.
+#define RESULT_FIELD_TEMP    0x0001
+#define RESULT_FIELD_PH      0x0002
+#define RESULT_FIELD_TDS     0x0004
+#define RESULT_FIELD_EC      0x0008   // ec_us_cm + ec_sample_us_cm
+#define RESULT_FIELD_SG      0x0010
+#define RESULT_FIELD_COLOR   0x0020   // r, g, b, hex
+#define RESULT_FIELD_LUX     0x0040
+#define RESULT_FIELD_CCT     0x0080
+#define RESULT_FIELD_CAMERA  0x0100
+#define RESULT_FIELDS_ALL    0x01FF
+
+// ============================================
+// ADVERTISED RESULT  (connectionless)
+// ============================================
+//
+// After every test the latest result is packed into manufacturer-specific
+// data in the ADVERTISING packet, so any scanner nearby gets it without
+// connecting. Layout of the 31-byte packet:
+//   flags (3) + 16-bit service UUID (4) + manufacturer data (4 + 20) = 31
+// The local name stays in the scan response where ArduinoBLE puts it.
+// Refreshed by stop/advertise only — no BLE.end()/begin(). While a central
+// is connected the stack isn't advertising, so the update is held and
+// applied when it disconnects.
+#define BLE_ADV_COMPANY_ID      0xFFFF   // Bluetooth SIG "no company / testing"
+#define BLE_ADV_RESULT_VERSION  1
+
+#define BLE_ADV_FLAG_CAMERA     0x01     // cam* fields are valid
+#define BLE_ADV_FLAG_SG_FAULT   0x02     // SG calibration fault (sg = 0)
+
+struct __attribute__((packed)) BLEAdvResultV1 {
+  uint8_t  version;       // BLE_ADV_RESULT_VERSION
+  uint32_t seq;           // history seq of this result
+  uint16_t pH_x1000;
+  uint16_t sg_x10000;
+  int16_t  tempC_x100;
+  uint16_t tdsPpm;
+  uint8_t  r, g, b;       // AS7341 normalised colour
+  uint8_t  flags;         // BLE_ADV_FLAG_*
+  uint8_t  camR, camG, camB;
+};
+static_assert(sizeof(BLEAdvResultV1) == 20, "BLEAdvResultV1 must fill the advertising packet exactly");
+
+// ============================================
+// CAMERA THUMBNAIL RELAY
+// ============================================
+//
+// JPEG bytes relayed from the ESP32-CAM are notified on THUMB_TX_CHAR_UUID
+// in packets of at most BLE_THUMB_PACKET_BYTES, each prefixed with a 16-bit
+// little-endian packet sequence number:
+//   seq 0x0000          header   — uint32 LE total JPEG size
+//   seq 0x0001..0xFFFE  data     — the next slice of the JPEG
+//   seq 0xFFFF          trailer  — uint8 1 = complete, 0 = aborted
+// The app reassembles by appending data packets in sequence order until the
+// advertised size is reached.
+#define BLE_THUMB_PACKET_BYTES      20     // one notification at the default ATT MTU
+
 // ============================================
 // EEPROM LAYOUT
 // ============================================
@@ -39,6 +199,12 @@
 // Maximum length for the broadcast device name (including null terminator)
 #define BLE_NAME_MAX_LEN  20
 
+// Per-peer result field masks (see RESULT FIELDS). BLESettings fills
+// 0x40..0x7E, so they sit in the gap after the colour calibration block.
+#define BLE_PEER_EEPROM_ADDR   0xA0
+#define BLE_PEER_EEPROM_MAGIC  0xF1
+#define BLE_PEER_SLOTS         4
+
 // ============================================
 // SETTINGS STRUCT
 // ============================================
@@ -65,6 +231,28 @@ extern BLESettings bleSettings;
 
 extern bool hasNewData;
 
+/**
+ * Connection state and metadata, maintained by the BLEConnected /
+ * BLEDisconnected event handlers (run from BLE.poll()). Reading it never
+ * touches the stack, so hot paths can check `bleLink.connected` freely.
+ */
+struct BLELinkInfo {
+  bool          connected;
+  char          peerAddress[18];   // "aa:bb:cc:dd:ee:ff" of the last central ("" if unknown)
+  uint16_t      attMtu;            // from the central's caps (legacy until then)
+  uint16_t      connIntervalMin;   // requested interval range, 1.25 ms units
+  uint16_t      connIntervalMax;   //   (the stack doesn't report the actual one)
+  unsigned long connectedAt;       // millis() of the last connect
+  unsigned long disconnectedAt;    // millis() of the last disconnect (0 = none)
+  uint32_t      connects;          // events since boot
+  uint32_t      disconnects;
+};
+
+extern BLELinkInfo bleLink;
+
+// DATA_TX, the characteristic dataTxWriter() sends on.
+extern BLECharacteristic dataTxCharacteristic;
+
 // ============================================
 // CORE FUNCTIONS
 // ============================================
@@ -82,24 +270,130 @@ bool bluetoothInit();
 void bluetoothUpdate();
 
 /**
- * Send a JSON document to the connected central via notification.
+ * Send a JSON document to the connected central via notification, split into
+ * (MTU - 3)-byte packets. No fixed sleep between packets: each writeValue()
+ * blocks until the controller can take it. Logs bytes/s and notification count.
  */
 void sendJsonData(const JsonDocument& jsonDoc);
 
+/**
+ * Largest heap in use (mallinfo().uordblks) sampled while a JSON document
+ * was alive: each sendJsonData(), each parsed DATA_RX write and each busy
+ * record. *path (if given) gets the document's "type" or command name.
+ */
+size_t bleJsonHeapPeak(const char** path);
+
+/** NotifyWriter on DATA_TX at the central's negotiated MTU. */
+inline NotifyWriter dataTxWriter() { return NotifyWriter(dataTxCharacteristic, bleLink.attMtu); }
+
+/**
+ * Send raw bytes (e.g. a BLEResultV1) on DATA_TX with the same MTU slicing
+ * and pacing as sendJsonData().
+ */
+void sendBinaryData(const uint8_t* data, size_t len);
+
+/**
+ * Handle {"cmd":"caps","mtu":<n>,"enc":"json"|"bin"} from the central: adopt
+ * its negotiated ATT MTU (clamped to BLE_LEGACY_ATT_MTU..BLE_MAX_ATT_MTU) and
+ * result encoding, and reply with what is now in use. Both reset (legacy MTU,
+ * JSON) on disconnect.
+ */
+void bleHandleCaps(const JsonDocument& caps);
+
+/**
+ * True if the connected central asked for binary (BLEResultV1) results.
+ */
+bool blePeerWantsBinary();
+
+/**
+ * RESULT_FIELD_* mask of the connected peer (RESULT_FIELDS_ALL if none is
+ * connected or it never chose one).
+ */
+uint16_t bleResultFields();
+
+/**
+ * Set and persist the connected peer's field mask (masked to
+ * RESULT_FIELDS_ALL). Returns false if no central is connected.
+ */
+bool bleSetResultFields(uint16_t mask);
+
+/**
+ * Put a result in the advertising packet (see ADVERTISED RESULT). Cheap:
+ * restarts advertising only, and defers that while a central is connected.
+ */
+void bleAdvertiseResult(uint32_t seq, const BLEResultV1& result);
+
 /**
  * Send a plain text message wrapped in a simple JSON envelope.
  */
-void sendMessage(const String& message);
+void sendMessage(const char* message);
+
+/**
+ * Ask for the fast connection interval (true) or give that request back
+ * (false). Requests nest: the relaxed interval is requested again only when
+ * every true has been matched by a false. A disconnect drops all of them.
+ */
+void bleRequestFastInterval(bool fast);
+
+// ---- Camera thumbnail sink (see cameraRelayThumbnail) ----
 
 /**
- * Returns true if a central is currently connected.
+ * Start a thumbnail transfer. Fails if no central is subscribed to
+ * THUMB_TX_CHAR_UUID.
+ */
+bool bleThumbBegin(uint32_t totalBytes);
+
+/**
+ * Notify one relayed chunk, split into BLE_THUMB_PACKET_BYTES packets.
+ * Each packet blocks in ArduinoBLE until the controller takes it, so no
+ * fixed sleep is needed; returns false once the central is gone.
+ */
+bool bleThumbChunk(const uint8_t* data, size_t len);
+
+/**
+ * Send the trailer packet and log notification count for the transfer.
+ */
+void bleThumbEnd(bool ok);
+
+// ---- Diagnostics stream (see DiagStream.h) ----
+
+/** True if a central is subscribed to DIAG_TX_CHAR_UUID. */
+bool bleDiagSubscribed();
+
+/**
+ * Notify one diagnostics frame. Blocks inside ArduinoBLE until the controller
+ * has a free buffer; returns false only if the central is no longer
+ * connected or subscribed.
+ */
+bool bleDiagNotify(const uint8_t* frame, size_t len);
+
+/**
+ * Returns true if a central is currently connected (cached; see bleLink).
  */
 bool isBluetoothConnected();
 
 /**
- * Returns the last received data as a JsonDocument and clears the flag.
+ * RSSI of the connected central in dBm (0 if none). Queries the controller,
+ * so keep it off hot paths (dev page only).
+ */
+int bleReadRssi();
+
+/**
+ * Returns the last received data and clears the flag. The document stays
+ * the caller's until bleReleaseReceived(): DATA_RX writes that land in the
+ * meantime (during any BLE.poll(), including inside sendJsonData()) are
+ * recorded for a busy reply instead of overwriting it.
+ */
+const JsonDocument& getReceivedJson();
+
+/** Done with getReceivedJson()'s document; the next write is parsed into it. */
+void bleReleaseReceived();
+
+/**
+ * Oldest command turned away as busy: its id (0 if none) and name. False when
+ * there are none left. Any beyond BLE_BUSY_MAX are only logged.
  */
-JsonDocument getReceivedJson();
+bool bleTakeBusy(uint32_t& id, char name[BLE_CMD_NAME_MAX]);
 
 // ============================================
 // SETTINGS MANAGEMENT
@@ -122,8 +416,11 @@ void bleSaveSettings();
 void bleResetToDefaults();
 
 /**
- * Apply bleSettings immediately: stop advertising, reconfigure BLE
- * with the new name / TX power / advertising flag, then restart.
+ * Apply bleSettings immediately, doing only what each changed field needs:
+ * manufacturer/model are rewritten in place, advertising on/off and name
+ * changes restart advertising only (deferred to disconnect while a central
+ * is connected), and a connected central is kept. The full BLE.end()/begin()
+ * restart is used only if the stack isn't running.
  * Call this after changing any field in bleSettings.
  */
 void bleApplySettings();
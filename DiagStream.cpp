@@ -0,0 +1,243 @@
+#include "DiagStream.h"
+#include "pHSensor.h"
+#include "tdsSensor.h"
+#include "colourSensor.h"
+#include "AnalogSampler.h"
+
+// ============================================
+// STATE
+// ============================================
+//
+// The ring and everything marked volatile are written by pushFrame(), which
+// runs in the sampler's timer ISR (or from loop() without a timer). loop()
+// only reads them, and takes frames out, with interrupts masked.
+
+static volatile unsigned long periodMs  = 0;   // 0 = stopped
+static volatile bool          streaming = false;   // period set AND a subscriber
+static volatile unsigned long nextDueAt = 0;
+static volatile uint16_t      frameSeq  = 0;
+
+static DiagFrame              ring[DIAG_RING_FRAMES];
+static volatile uint8_t       ringHead  = 0;   // next write
+static volatile uint8_t       ringCount = 0;
+static volatile uint32_t      acquired  = 0;
+static volatile uint32_t      dropped   = 0;
+static volatile uint8_t       queueMax  = 0;
+
+// Newest AS7341 read, copied into every frame.
+static DiagFrame              colorSnap;
+static unsigned long          colorDueAt = 0;
+
+static DiagStats     stats;
+static unsigned long windowStart    = 0;
+static uint32_t      windowAcquired = 0;   // `acquired` at window start
+static uint32_t      windowSent     = 0;
+static uint32_t      windowColorUs  = 0;   // summed colorReadRaw() time this window
+static uint32_t      windowColors   = 0;
+static uint32_t      windowTxUs     = 0;   // summed bleDiagNotify() time this window
+
+// ============================================
+// ACQUISITION
+// ============================================
+
+/**
+ * Build a frame from one tick's counts and queue it if one is due, dropping
+ * the oldest queued frame when the ring is full. Runs in the timer ISR.
+ */
+static void pushFrame(const uint16_t* counts) {
+  if (!streaming) return;
+  unsigned long now = millis();
+  if ((long)(now - nextDueAt) < 0) return;
+  // Schedule from the due time so the rate holds; after a stall (no timer,
+  // long loop pass) restart from now rather than burst.
+  nextDueAt += periodMs;
+  if ((long)(now - nextDueAt) >= 0) nextDueAt = now + periodMs;
+
+  if (ringCount == DIAG_RING_FRAMES) {
+    ringCount--;   // overwrite the oldest
+    dropped++;
+  }
+  DiagFrame& f = ring[ringHead];
+  f          = colorSnap;
+  f.magic    = DIAG_FRAME_MAGIC;
+  f.seq      = frameSeq++;
+  f.dropped  = dropped > 0xFFFF ? 0xFFFF : (uint16_t)dropped;
+  f.tMs      = now;
+  f.phV      = analogCountsToVolts(counts[ANALOG_CH_PH]);
+  f.tdsV     = analogCountsToVolts(counts[ANALOG_CH_TDS]);
+  if (tdsIsPowered()) f.flags |= DIAG_FLAG_TDS_POWERED;
+
+  ringHead = (uint8_t)((ringHead + 1) % DIAG_RING_FRAMES);
+  ringCount++;
+  if (ringCount > queueMax) queueMax = ringCount;
+  acquired++;
+}
+
+/** Read the AS7341 (blocking) into the snapshot the ISR copies from. */
+static void refreshColor() {
+  unsigned long t0 = micros();
+  RawRGBC raw = colorReadRaw();
+  windowColorUs += micros() - t0;
+  windowColors++;
+
+  DiagFrame snap = {};
+  if (raw.satAnalog)      snap.flags |= DIAG_FLAG_SAT_ANALOG;
+  if (raw.satDigital)     snap.flags |= DIAG_FLAG_SAT_DIGITAL;
+  if (illuminatorIsOn())  snap.flags |= DIAG_FLAG_ILLUM_ON;
+  snap.gain  = colorGetGain();
+  snap.atime = colorGetIntegrationTime();
+  snap.r = raw.r;   snap.g = raw.g;   snap.b = raw.b;   snap.c = raw.c;
+  snap.f1 = raw.f1; snap.f2 = raw.f2; snap.f3 = raw.f3; snap.f4 = raw.f4;
+  snap.f5 = raw.f5; snap.f6 = raw.f6; snap.f7 = raw.f7; snap.f8 = raw.f8;
+  snap.nir = raw.nir;
+
+  noInterrupts();
+  colorSnap = snap;
+  interrupts();
+}
+
+/** Oldest queued frame, or false if the ring is empty. */
+static bool popFrame(DiagFrame& out) {
+  noInterrupts();
+  bool have = ringCount > 0;
+  if (have) {
+    uint8_t tail = (uint8_t)((ringHead + DIAG_RING_FRAMES - ringCount) % DIAG_RING_FRAMES);
+    out = ring[tail];
+    ringCount--;
+  }
+  interrupts();
+  return have;
+}
+
+static void resetRing() {
+  noInterrupts();
+  ringHead  = 0;
+  ringCount = 0;
+  acquired  = 0;
+  dropped   = 0;
+  queueMax  = 0;
+  frameSeq  = 0;
+  nextDueAt = millis();
+  interrupts();
+}
+
+// ============================================
+// STATS
+// ============================================
+
+static void reportStats() {
+  unsigned long now = millis();
+  unsigned long span = now - windowStart;
+  if (span < DIAG_STATS_PERIOD_MS) return;
+
+  DiagStats st = diagStreamStats();
+  uint32_t windowAcq = st.acquired - windowAcquired;
+  stats.acquireFps = windowAcq  * 1000.0f / span;
+  stats.sendFps    = windowSent * 1000.0f / span;
+  stats.colorMs    = windowColors ? windowColorUs / 1000.0f / windowColors : 0.0f;
+  stats.notifyMs   = windowSent   ? windowTxUs    / 1000.0f / windowSent   : 0.0f;
+  Serial.print("[Diag] "); Serial.print(stats.acquireFps, 1);
+  Serial.print(" fps acquired, "); Serial.print(stats.sendFps, 1);
+  Serial.print(" fps sent; colour "); Serial.print(stats.colorMs, 1);
+  Serial.print(" ms, notify "); Serial.print(stats.notifyMs, 1);
+  Serial.print(" ms per frame; queue max "); Serial.print(st.queueMax);
+  Serial.print('/'); Serial.print(DIAG_RING_FRAMES);
+  Serial.print(", "); Serial.print(st.dropped);
+  Serial.print(" dropped, "); Serial.print(stats.failed);
+  Serial.println(" failed total");
+
+  windowStart    = now;
+  windowAcquired = st.acquired;
+  windowSent     = 0;
+  windowColorUs  = 0;
+  windowColors   = 0;
+  windowTxUs     = 0;
+}
+
+// ============================================
+// PUBLIC
+// ============================================
+
+void diagStreamSetPeriod(unsigned long period) {
+  if (period != 0 && period < DIAG_MIN_PERIOD_MS) period = DIAG_MIN_PERIOD_MS;
+  if (streaming) bleRequestFastInterval(false);
+  streaming = false;
+  periodMs  = period;
+  resetRing();
+  colorDueAt = millis();
+  memset(&stats, 0, sizeof(stats));
+  windowStart    = millis();
+  windowAcquired = 0;
+  windowSent     = 0;
+  windowColorUs  = 0;
+  windowColors   = 0;
+  windowTxUs     = 0;
+
+  if (period == 0) {
+    analogSamplerSetTickHook(nullptr);
+    Serial.println("[Diag] Stream stopped.");
+  } else {
+    analogSamplerSetTickHook(pushFrame);
+    Serial.print("[Diag] Streaming every "); Serial.print(period);
+    Serial.print(" ms ("); Serial.print((unsigned)sizeof(DiagFrame));
+    Serial.print(" B frames, "); Serial.print(DIAG_RING_FRAMES);
+    Serial.println("-frame queue).");
+  }
+}
+
+unsigned long diagStreamPeriod() {
+  return periodMs;
+}
+
+void diagStreamService() {
+  bool subscribed = periodMs != 0 && bleDiagSubscribed();
+  if (subscribed != streaming) {
+    if (subscribed) resetRing();   // don't send frames from a previous subscriber
+    streaming = subscribed;
+    bleRequestFastInterval(subscribed);
+  }
+  if (!streaming) return;
+
+  if ((long)(millis() - colorDueAt) >= 0) {
+    colorDueAt = millis() + periodMs;
+    refreshColor();
+  }
+
+  // No sampler timer: acquire from here with blocking reads instead.
+  if (!analogSamplerRunning()) {
+    uint16_t counts[ANALOG_CH_COUNT] = { 0 };
+    counts[ANALOG_CH_PH] = analogReadOversampled(PH_SENSOR_PIN);
+    if (tdsIsPowered()) counts[ANALOG_CH_TDS] = analogReadOversampled(TDS_SENSOR_PIN);
+    pushFrame(counts);
+  }
+
+  // Drain what is queued now, not what arrives meanwhile, so a link slower
+  // than the acquisition rate can't hold loop() here indefinitely.
+  noInterrupts();
+  uint8_t pending = ringCount;
+  interrupts();
+  DiagFrame f;
+  while (pending-- && popFrame(f)) {
+    unsigned long t0 = micros();
+    bool ok = bleDiagNotify((const uint8_t*)&f, sizeof(DiagFrame));
+    windowTxUs += micros() - t0;
+    if (ok) {
+      stats.sent++;
+      windowSent++;
+    } else {
+      stats.failed++;
+    }
+  }
+
+  reportStats();
+}
+
+DiagStats diagStreamStats() {
+  DiagStats st = stats;
+  noInterrupts();
+  st.acquired = acquired;
+  st.dropped  = dropped;
+  st.queueMax = queueMax;
+  interrupts();
+  return st;
+}
@@ -0,0 +1,100 @@
+#ifndef DIAG_STREAM_H
+#define DIAG_STREAM_H
+
+#include <Arduino.h>
+#include "Bluetooth.h"
+
+// ============================================
+// LIVE DIAGNOSTICS STREAM
+// ============================================
+//
+// Raw sensor frames notified on DIAG_TX_CHAR_UUID for characterising a unit
+// from a host instead of reading the dev screen. Off until started with
+// {"cmd":"diag","period_ms":P} (0 stops), and only acquires while a central
+// is subscribed to the characteristic.
+//
+// Acquisition and sending are decoupled by a ring of DIAG_RING_FRAMES frames:
+//
+//   acquire  the background sampler's tick hook (timer ISR) builds a frame
+//            every P ms from that tick's pH/TDS counts plus the newest colour
+//            snapshot, and pushes it. Without a sampler timer, loop() does
+//            the same from blocking reads.
+//   colour   loop() refreshes the AS7341 snapshot at most once per P ms; a
+//            read blocks for its integration time, so the colour fields
+//            update at the sensor's own rate (~8/s at the default ATIME).
+//   notify   loop() drains the frames that were queued when it started.
+//            ArduinoBLE's writeValue() blocks until the controller has a
+//            free buffer, so a slow link slows the drain, not acquisition.
+//
+// When the ring is full the OLDEST frame is dropped for the new one, so the
+// host always gets the most recent data; each frame carries the running
+// dropped count, and gaps in seq show exactly where. A notify only fails
+// when the central has gone (disconnected or unsubscribed).
+//
+// A frame is sizeof(DiagFrame) bytes in one notification, so the central
+// must have negotiated an ATT MTU >= sizeof(DiagFrame) + 3 (nRF Connect,
+// bleak, iOS and Android all do by default).
+#define DIAG_MIN_PERIOD_MS     10
+#define DIAG_RING_FRAMES       16      // queued frames between acquire and notify
+#define DIAG_STATS_PERIOD_MS   5000    // Serial fps/timing report interval
+
+#define DIAG_FRAME_MAGIC       0xD2    // 0xD1 frames carried raw ADC counts
+
+#define DIAG_FLAG_TDS_POWERED  0x01
+#define DIAG_FLAG_SAT_ANALOG   0x02
+#define DIAG_FLAG_SAT_DIGITAL  0x04
+#define DIAG_FLAG_ILLUM_ON     0x08    // external white LEDs lit
+
+/**
+ * One diagnostics frame. Packed, little-endian. phV/tdsV are one sampler
+ * tick (oversampled, otherwise unfiltered) converted to volts at the ADC
+ * pin with analogCountsToVolts(); tdsV is 0 while the probe is unpowered.
+ * The colour fields are the newest completed AS7341 read.
+ */
+struct __attribute__((packed)) DiagFrame {
+  uint8_t  magic;        // DIAG_FRAME_MAGIC
+  uint16_t seq;          // per-frame counter; gaps = dropped frames
+  uint16_t dropped;      // frames dropped since the stream started (saturates)
+  uint32_t tMs;          // millis() at acquisition
+  float    phV;          // pH probe (A0), volts
+  float    tdsV;         // TDS probe (A1), volts
+  uint8_t  flags;        // DIAG_FLAG_*
+  uint8_t  gain;         // AS7341 AGAIN
+  uint8_t  atime;        // AS7341 ATIME
+  uint16_t r, g, b, c;   // RawRGBC quad
+  uint16_t f1, f2, f3, f4, f5, f6, f7, f8, nir;
+};
+static_assert(sizeof(DiagFrame) <= BLE_DIAG_FRAME_MAX_BYTES, "DiagFrame too large for the characteristic");
+
+struct DiagStats {
+  uint32_t acquired;     // frames pushed into the ring
+  uint32_t sent;         // frames notified
+  uint32_t dropped;      // oldest frames overwritten by a full ring
+  uint32_t failed;       // notifies refused (central gone mid-stream)
+  uint8_t  queueMax;     // fullest the ring has been
+  float    acquireFps;   // over the last stats window
+  float    sendFps;
+  float    colorMs;      // mean AS7341 read time, last window
+  float    notifyMs;     // mean time blocked in writeValue() per frame, last window
+};
+
+/**
+ * Start streaming with one frame every periodMs (clamped to at least
+ * DIAG_MIN_PERIOD_MS), or stop if periodMs is 0. Resets the counters.
+ */
+void diagStreamSetPeriod(unsigned long periodMs);
+
+/** Current period in ms (0 = stopped). */
+unsigned long diagStreamPeriod();
+
+/**
+ * Refresh the colour snapshot if due, acquire a frame here if there is no
+ * sampler timer, and notify the frames queued so far. Call every loop()
+ * pass (and from screens that keep the main loop from running).
+ */
+void diagStreamService();
+
+/** Counters since the stream was last started. */
+DiagStats diagStreamStats();
+
+#endif // DIAG_STREAM_H
@@ -0,0 +1,186 @@
+#include "History.h"
+#include "pHSensor.h"
+#include <RTC.h>
+
+// The pH N-point record is the region directly below the history.
+static_assert(PH_EEPROM_ADDR + sizeof(pHCalibration) <= HISTORY_EEPROM_ADDR,
+              "pHCalibration overruns the history region");
+
+// ============================================
+// STATE
+// ============================================
+
+static uint16_t headSlot  = 0;   // slot holding the newest record
+static uint32_t newestSeq = 0;   // 0 = empty history
+static uint16_t validCount = 0;
+
+// ============================================
+// HELPERS
+// ============================================
+
+/** CRC-8, polynomial 0x07, init 0x00. */
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/** EEPROM address of ring slot i; records never straddle a sector. */
+static int slotAddr(uint16_t slot) {
+  return HISTORY_EEPROM_ADDR
+       + (slot / HISTORY_RECORDS_PER_SECTOR) * HISTORY_SECTOR_BYTES
+       + (slot % HISTORY_RECORDS_PER_SECTOR) * sizeof(HistoryRecord);
+}
+
+static bool readSlot(uint16_t slot, HistoryRecord& rec) {
+  EEPROM.get(slotAddr(slot), rec);
+  if (rec.seq == 0 || rec.seq == 0xFFFFFFFFUL) return false;
+  if (rec.result.magic != BLE_RESULT_BIN_MAGIC) return false;
+  return rec.crc == crc8((const uint8_t*)&rec, sizeof(rec) - 1);
+}
+
+static uint32_t rtcNow() {
+  RTCTime now;
+  RTC.getTime(now);
+  return (uint32_t)now.getUnixTime();
+}
+
+// ============================================
+// INIT
+// ============================================
+
+void historyInit() {
+  RTC.begin();
+
+  headSlot   = 0;
+  newestSeq  = 0;
+  validCount = 0;
+
+  HistoryRecord rec;
+  for (uint16_t slot = 0; slot < HISTORY_CAPACITY; slot++) {
+    if (!readSlot(slot, rec)) continue;
+    validCount++;
+    if (rec.seq > newestSeq) {
+      newestSeq = rec.seq;
+      headSlot  = slot;
+    }
+  }
+
+  Serial.print("[Hist] "); Serial.print(validCount);
+  Serial.print(" of "); Serial.print((unsigned)HISTORY_CAPACITY);
+  Serial.print(" records, newest seq "); Serial.println(newestSeq);
+}
+
+// ============================================
+// APPEND
+// ============================================
+
+uint32_t historyAppend(const BLEResultV1& result) {
+  uint16_t slot = (newestSeq == 0) ? 0 : (uint16_t)((headSlot + 1) % HISTORY_CAPACITY);
+
+  // Entering a new sector means recycling the oldest one once the ring
+  // has wrapped; note it so wear can be followed on the Serial log.
+  if (slot % HISTORY_RECORDS_PER_SECTOR == 0) {
+    Serial.print("[Hist] Writing sector ");
+    Serial.println(slot / HISTORY_RECORDS_PER_SECTOR);
+  }
+
+  HistoryRecord rec;
+  bool overwriting = readSlot(slot, rec);
+
+  rec.seq       = newestSeq + 1;
+  rec.timestamp = rtcNow();
+  rec.result    = result;
+  rec.crc       = crc8((const uint8_t*)&rec, sizeof(rec) - 1);
+  EEPROM.put(slotAddr(slot), rec);
+
+  headSlot  = slot;
+  newestSeq = rec.seq;
+  if (!overwriting) validCount++;
+
+  Serial.print("[Hist] Stored seq "); Serial.print(rec.seq);
+  Serial.print(" in slot "); Serial.println(slot);
+  return rec.seq;
+}
+
+bool historyReadNewest(HistoryRecord& rec) {
+  if (newestSeq == 0) return false;
+  return readSlot(headSlot, rec);
+}
+
+uint32_t historyNewestSeq() {
+  return newestSeq;
+}
+
+uint16_t historyCount() {
+  return validCount;
+}
+
+void historySetTime(uint32_t unixTime) {
+  RTCTime t((time_t)unixTime);
+  RTC.setTime(t);
+  Serial.print("[Hist] RTC set to "); Serial.println(unixTime);
+}
+
+// ============================================
+// BLE SYNC
+// ============================================
+
+int historySyncSince(uint32_t sinceSeq) {
+  if (!isBluetoothConnected()) return -1;
+
+  // Walk the ring oldest-first (the slot after the head) so records go out
+  // in seq order. First pass counts, second pass streams.
+  uint16_t oldest = (uint16_t)((headSlot + 1) % HISTORY_CAPACITY);
+  HistoryRecord rec;
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < HISTORY_CAPACITY; i++) {
+    uint16_t slot = (uint16_t)((oldest + i) % HISTORY_CAPACITY);
+    if (readSlot(slot, rec) && rec.seq > sinceSeq) count++;
+  }
+
+  Serial.print("[Hist] Sync since "); Serial.print(sinceSeq);
+  Serial.print(": "); Serial.print(count); Serial.println(" records.");
+
+  unsigned long start = millis();
+  bleRequestFastInterval(true);
+  NotifyWriter writer = dataTxWriter();
+  uint8_t header[4] = { HISTORY_SYNC_MAGIC, (uint8_t)sizeof(HistoryRecord),
+                        (uint8_t)(count), (uint8_t)(count >> 8) };
+  writer.write(header, sizeof(header));
+
+  uint16_t sent = 0;
+  uint32_t lastSeq = sinceSeq;
+  for (uint16_t i = 0; i < HISTORY_CAPACITY && sent < count && writer.ok(); i++) {
+    uint16_t slot = (uint16_t)((oldest + i) % HISTORY_CAPACITY);
+    if (!readSlot(slot, rec) || rec.seq <= sinceSeq) continue;
+    if (writer.write((const uint8_t*)&rec, sizeof(rec)) != sizeof(rec)) break;
+    sent++;
+    lastSeq = rec.seq;
+  }
+  bool ok = writer.finish(start);
+  bleRequestFastInterval(false);
+  unsigned long elapsed = millis() - start;
+
+  Serial.print("[Hist] Sent "); Serial.print(sent);
+  Serial.print(" records in "); Serial.print(elapsed); Serial.print(" ms");
+  if (elapsed > 0) {
+    Serial.print(" ("); Serial.print((unsigned long)sent * 1000UL / elapsed);
+    Serial.print(" rec/s)");
+  }
+  Serial.println();
+  if (!ok) return -1;
+
+  JsonDocument doc;
+  doc["type"]   = "history_end";
+  doc["sent"]   = sent;
+  doc["last"]   = lastSeq;
+  doc["newest"] = newestSeq;
+  sendJsonData(doc);
+  return sent;
+}
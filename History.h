@@ -0,0 +1,110 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "Bluetooth.h"
+
+// ============================================
+// OFFLINE RESULT HISTORY
+// ============================================
+//
+// Every test result is appended to a ring of fixed-size records in the
+// UNO R4's data flash (the EEPROM library's backing store), so results
+// taken without a phone connected can be synced later.
+//
+// Layout: HISTORY_SECTOR_COUNT sectors of HISTORY_SECTOR_BYTES, each the
+// size of one data-flash erase block, starting at HISTORY_EEPROM_ADDR.
+// Records never straddle a sector. The writer fills slots strictly in order
+// and wraps to the first sector after the last, so every block is written
+// once per pass round the ring (no hot spots) and the oldest sector is the
+// one that gets recycled.
+//
+// Each record carries a monotonic sequence number (starting at 1, never
+// reused) and a CRC-8. On boot the ring is scanned once: the slot with the
+// highest valid seq is the head, and a torn write (power lost mid-put) just
+// fails its CRC and is ignored.
+//
+// Device EEPROM map:
+//   0x000  pH calibration, legacy 3-point (PH_LEGACY_EEPROM_ADDR)
+//   0x020  TDS calibration       (TDS_EEPROM_ADDR)
+//   0x040  BLE settings          (BLE_EEPROM_ADDR)
+//   0x080  Colour calibration    (COLOR_EEPROM_ADDR)
+//   0x0A0  BLE peer field masks  (BLE_PEER_EEPROM_ADDR)
+//   0x0C8  pH calibration        (PH_EEPROM_ADDR)
+//   0x400  Result history        <-- here, to the end of data flash
+#define HISTORY_EEPROM_ADDR    0x400
+#define HISTORY_SECTOR_BYTES   1024     // RA4M1 data-flash erase block
+#define HISTORY_SECTOR_COUNT   7        // 0x400..0x1FFF (8 KB data flash)
+
+// ============================================
+// BLE SYNC
+// ============================================
+//
+// {"cmd":"history","since":N} — stream every stored record with seq > N,
+// oldest first, as one binary payload on DATA_TX:
+//   uint8  HISTORY_SYNC_MAGIC
+//   uint8  sizeof(HistoryRecord)
+//   uint16 LE record count
+//   count × HistoryRecord
+// followed by {"type":"history_end","sent":n,"last":seq,"newest":seq}.
+// The app resumes after a dropped link by asking again with the seq of the
+// last complete record it holds; records are self-checking (CRC-8).
+//
+// {"cmd":"time","unix":T} sets the RTC so later records get wall-clock
+// timestamps (the R4 has no RTC battery; until set, timestamps count from
+// the RTC's reset value).
+#define HISTORY_SYNC_MAGIC     0xB2
+
+/**
+ * One stored result. Packed, little-endian; the payload is the same
+ * BLEResultV1 the binary BLE encoding uses.
+ */
+struct __attribute__((packed)) HistoryRecord {
+  uint32_t    seq;         // 1, 2, 3, ... (0 / 0xFFFFFFFF = empty slot)
+  uint32_t    timestamp;   // RTC, Unix seconds
+  BLEResultV1 result;
+  uint8_t     crc;         // CRC-8 over all preceding bytes
+};
+
+#define HISTORY_RECORDS_PER_SECTOR  (HISTORY_SECTOR_BYTES / sizeof(HistoryRecord))
+#define HISTORY_CAPACITY            (HISTORY_RECORDS_PER_SECTOR * HISTORY_SECTOR_COUNT)
+
+// ============================================
+// FUNCTIONS
+// ============================================
+
+/**
+ * Start the RTC and scan the ring for the newest record.
+ * Call once at boot (the History boot task).
+ */
+void historyInit();
+
+/**
+ * Append a result, stamped with the next seq and the current RTC time.
+ * @return the seq assigned.
+ */
+uint32_t historyAppend(const BLEResultV1& result);
+
+/** Copy out the newest record. Returns false if the history is empty. */
+bool historyReadNewest(HistoryRecord& rec);
+
+/** Seq of the newest stored record (0 if the history is empty). */
+uint32_t historyNewestSeq();
+
+/** Number of valid records currently stored (<= HISTORY_CAPACITY). */
+uint16_t historyCount();
+
+/**
+ * Stream all records with seq > sinceSeq to the connected central
+ * (see BLE SYNC above). Logs records/s.
+ * @return number of records sent, or -1 if not connected / aborted.
+ */
+int historySyncSince(uint32_t sinceSeq);
+
+/**
+ * Set the RTC from a Unix timestamp (the app's {"cmd":"time"}).
+ */
+void historySetTime(uint32_t unixTime);
+
+#endif // HISTORY_H
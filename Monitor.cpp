@@ -0,0 +1,162 @@
+#include "Monitor.h"
+#include "pHSensor.h"
+#include "tdsSensor.h"
+#include "TempSensor.h"
+#include "Bluetooth.h"
+#include <ArduinoJson.h>
+
+// ============================================
+// STATE
+// ============================================
+
+static unsigned long periodMs   = 0;   // 0 = stopped
+static unsigned long nextDueAt  = 0;
+static unsigned long lastSample = 0;   // millis() of the previous sample
+static unsigned long tdsOnAt    = 0;   // when monitoring (re)powered the probe
+
+static MonitorReading cur;
+static bool           seeded    = false;   // pH/temp averages hold a sample
+static bool           tdsSeeded = false;   // EC average holds a sample
+
+// Values in the last notification, and when it went out.
+static MonitorReading sent;
+static bool           sentAny  = false;
+static unsigned long  sentAt   = 0;
+
+// ============================================
+// HELPERS
+// ============================================
+
+/** Move avg toward x by weight a (seeding it on the first sample). */
+static void ewma(float& avg, float x, float a, bool seed) {
+  avg = seed ? x : avg + a * (x - avg);
+}
+
+/** Keep the probe on; after any OFF (a test, a calibration) restart the settle clock. */
+static void holdTdsPower() {
+  if (tdsIsPowered()) return;
+  tdsPowerOn();
+  tdsOnAt       = millis();
+  tdsSeeded     = false;
+  cur.tdsValid  = false;
+}
+
+static void sample() {
+  unsigned long now = millis();
+  // Weight for the actual gap, so a late pass (a test ran in between)
+  // counts for as much time as it really covers.
+  float a = 1.0f - expf(-(float)(now - lastSample) / (float)MONITOR_EWMA_TAU_MS);
+  lastSample = now;
+
+  float temp = pHReadTemperature();
+  float pH   = voltageToPH(pHReadVoltage(), temp);
+  ewma(cur.tempC, temp, a, !seeded);
+  ewma(cur.pH,    pH,   a, !seeded);
+  seeded = true;
+
+  // Conductivity only once the isolator has settled since power-on; an
+  // unsettled reading would drag the average for several time constants.
+  if (now - tdsOnAt >= TDS_POWER_SETTLE_MS) {
+    float ec = voltageToEC(tdsReadVoltage(), temp);
+    if (ec > 0.0f) {   // 0 = calibration-fault sentinel, not a reading
+      ewma(cur.ecUsCm, ec, a, !tdsSeeded);
+      cur.tdsPpm   = ecToTDS(cur.ecUsCm);
+      cur.tdsValid = true;
+      tdsSeeded    = true;
+    }
+  }
+  cur.samples++;
+}
+
+/** True if any smoothed value has left its deadband around the last notification. */
+static bool changed() {
+  if (!sentAny) return true;
+  if (fabsf(cur.pH    - sent.pH)    > MONITOR_DEADBAND_PH)     return true;
+  if (fabsf(cur.tempC - sent.tempC) > MONITOR_DEADBAND_TEMP_C) return true;
+  if (cur.tdsValid != sent.tdsValid) return true;
+  if (cur.tdsValid && fabsf(cur.tdsPpm - sent.tdsPpm) > MONITOR_DEADBAND_TDS_PPM) return true;
+  return false;
+}
+
+static void notify() {
+  JsonDocument doc;
+  doc["type"]   = "monitor";
+  doc["n"]      = cur.samples;
+  doc["pH"]     = cur.pH;
+  doc["temp_c"] = cur.tempC;
+  if (cur.tdsValid) {
+    doc["tds_ppm"]  = cur.tdsPpm;
+    doc["ec_us_cm"] = cur.ecUsCm;
+  }
+  sendJsonData(doc);
+
+  cur.notifies++;
+  sent    = cur;
+  sentAny = true;
+  sentAt  = millis();
+}
+
+// ============================================
+// PUBLIC
+// ============================================
+
+void monitorSetPeriod(unsigned long period) {
+  if (period == 0) {
+    if (periodMs != 0) {
+      tdsPowerOff();
+      Serial.print("[Monitor] Stopped after "); Serial.print(cur.samples);
+      Serial.print(" samples, "); Serial.print(cur.notifies);
+      Serial.println(" notifications.");
+    }
+    periodMs = 0;
+    return;
+  }
+
+  if (period < MONITOR_MIN_PERIOD_MS) period = MONITOR_MIN_PERIOD_MS;
+  if (period > MONITOR_MAX_PERIOD_MS) period = MONITOR_MAX_PERIOD_MS;
+
+  if (periodMs == 0) {
+    memset(&cur, 0, sizeof(cur));
+    seeded     = false;
+    tdsSeeded  = false;
+    sentAny    = false;
+    lastSample = millis();
+    nextDueAt  = millis();
+    tdsOnAt    = millis();
+    tdsPowerOn();   // no-op (and no settle restart) if already on
+    tempStartConversion();
+  }
+  periodMs = period;
+
+  Serial.print("[Monitor] Sampling every "); Serial.print(period);
+  Serial.println(" ms.");
+}
+
+unsigned long monitorPeriod() {
+  return periodMs;
+}
+
+bool monitorActive() {
+  return periodMs != 0;
+}
+
+void monitorService() {
+  if (periodMs == 0) return;
+  holdTdsPower();
+  if ((long)(millis() - nextDueAt) < 0) return;
+
+  // Schedule from the due time so the rate holds; if a test or screen held
+  // the loop up for several periods, skip the missed ones rather than burst.
+  nextDueAt += periodMs;
+  if ((long)(millis() - nextDueAt) >= 0) nextDueAt = millis() + periodMs;
+
+  sample();
+  if (isBluetoothConnected() &&
+      (changed() || millis() - sentAt >= MONITOR_HEARTBEAT_MS)) {
+    notify();
+  }
+}
+
+MonitorReading monitorReading() {
+  return cur;
+}
@@ -0,0 +1,74 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <Arduino.h>
+
+// ============================================
+// CONTINUOUS pH / TDS MONITORING
+// ============================================
+//
+// For probes left in a flowing or collected sample: instead of a full test
+// per reading (TDS power cycle, colour, camera), the TDS probe is held
+// powered and pH, conductivity and temperature are sampled every period
+// from the background sampler and TempSensor, none of which wait on the ADC.
+//
+// Each sample updates an exponentially weighted moving average per value.
+// The weight is derived from MONITOR_EWMA_TAU_MS and the actual gap since
+// the previous sample, so the smoothing time constant does not change with
+// the period. A {"type":"monitor",...} notification goes out only when a
+// smoothed value has moved more than its deadband since the last one sent,
+// or MONITOR_HEARTBEAT_MS has passed, so a steady sample costs almost no
+// radio traffic.
+//
+// Started with {"cmd":"monitor","period_ms":P} (0 stops) or from the
+// Sensors > Live Monitor screen. If a test or calibration switches the TDS
+// probe off, monitoring powers it back on and holds conductivity out of
+// the averages until TDS_POWER_SETTLE_MS has passed.
+#define MONITOR_DEFAULT_PERIOD_MS   1000
+#define MONITOR_MIN_PERIOD_MS        250
+#define MONITOR_MAX_PERIOD_MS     600000
+
+#define MONITOR_EWMA_TAU_MS         5000   // smoothing time constant
+
+// Change that triggers a notification, in smoothed units.
+#define MONITOR_DEADBAND_PH         0.02f
+#define MONITOR_DEADBAND_TDS_PPM    5.0f
+#define MONITOR_DEADBAND_TEMP_C     0.2f
+#define MONITOR_HEARTBEAT_MS       60000   // notify at least this often anyway
+
+/** Smoothed state, as last computed. */
+struct MonitorReading {
+  float    pH;
+  float    ecUsCm;      // CELL EC, normalised to TDS_TEMP_REF_C
+  float    tdsPpm;
+  float    tempC;
+  bool     tdsValid;    // false while the probe is still settling
+  uint32_t samples;     // since monitoring started
+  uint32_t notifies;    // BLE notifications sent since monitoring started
+};
+
+/**
+ * Start monitoring with one sample every periodMs (clamped to
+ * MONITOR_MIN_PERIOD_MS..MONITOR_MAX_PERIOD_MS), or stop if periodMs is 0.
+ * Starting powers the TDS probe; stopping powers it off. Restarting while
+ * running only changes the period.
+ */
+void monitorSetPeriod(unsigned long periodMs);
+
+/** Current period in ms (0 = stopped). */
+unsigned long monitorPeriod();
+
+/** True while monitoring. */
+bool monitorActive();
+
+/**
+ * Take a sample if one is due, update the averages and notify on change.
+ * Call every loop() pass (and from screens that keep the main loop from
+ * running).
+ */
+void monitorService();
+
+/** Smoothed values and counters. */
+MonitorReading monitorReading();
+
+#endif // MONITOR_H
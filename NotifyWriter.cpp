@@ -0,0 +1,61 @@
+#include "NotifyWriter.h"
+
+// The notification being assembled. Static so no send path touches the
+// heap or puts a packet on the stack.
+static uint8_t txPacket[NOTIFY_PACKET_MAX_BYTES];
+
+NotifyWriter::NotifyWriter(BLECharacteristic& chr, uint16_t attMtu)
+    : chr(chr), used(0), bytes(0), notifications(0), failed(false) {
+  packetSize = attMtu > 3 ? attMtu - 3 : 1;
+  if (packetSize > sizeof(txPacket)) packetSize = sizeof(txPacket);
+}
+
+size_t NotifyWriter::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t NotifyWriter::write(const uint8_t* data, size_t len) {
+  size_t taken = 0;
+  while (taken < len && !failed) {
+    size_t n = packetSize - used;
+    if (n > len - taken) n = len - taken;
+    memcpy(txPacket + used, data + taken, n);
+    used  += n;
+    taken += n;
+    if (used == packetSize) flushPacket();
+  }
+  return failed ? 0 : taken;
+}
+
+bool NotifyWriter::finish(unsigned long startMs) {
+  if (used > 0 && !failed) flushPacket();
+  if (failed) {
+    Serial.print("[BLE] Send aborted after "); Serial.print((unsigned long)bytes);
+    Serial.println(" bytes (link lost or stalled).");
+    return false;
+  }
+  unsigned long elapsed = millis() - startMs;
+  Serial.print("[BLE] Send complete: "); Serial.print((unsigned)notifications);
+  Serial.print(" notifications of <="); Serial.print((unsigned long)packetSize);
+  Serial.print(" B, "); Serial.print(elapsed); Serial.print(" ms");
+  if (elapsed > 0) {
+    Serial.print(", "); Serial.print((unsigned long)bytes * 1000UL / elapsed);
+    Serial.print(" B/s");
+  }
+  Serial.println();
+  return true;
+}
+
+void NotifyWriter::flushPacket() {
+  // ArduinoBLE does not auto-chunk notify payloads; each writeValue() is one
+  // notification. It blocks until the controller has a free buffer (that is
+  // the pacing) and returns 0 only when no central is connected and
+  // subscribed, which retrying cannot fix.
+  if (chr.writeValue(txPacket, (int)used) == 0) {
+    failed = true;
+    return;
+  }
+  bytes += used;
+  notifications++;
+  used = 0;
+}
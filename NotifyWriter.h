@@ -0,0 +1,57 @@
+#ifndef NOTIFY_WRITER_H
+#define NOTIFY_WRITER_H
+
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+
+// ============================================
+// NOTIFY WRITER
+// ============================================
+//
+// Print sink that slices whatever is written to it into notifications of at
+// most (ATT MTU - 3) bytes on one characteristic, so serializers and
+// multi-part binary streams write straight into the radio without building
+// the whole payload. Only the packet being assembled is buffered, in one
+// static NOTIFY_PACKET_MAX_BYTES array shared by all writers (one send runs
+// at a time). Kept apart from the BLE module so it can be built on a host
+// against a stub characteristic (test/host/notify_writer_test.cpp).
+//
+// Every packet but the last is exactly full. Once a notification fails
+// (central gone) nothing more is sent and write() returns 0.
+
+// Largest packet assembled: (BLE_MAX_ATT_MTU - 3), asserted in Bluetooth.cpp.
+#define NOTIFY_PACKET_MAX_BYTES   182
+
+class NotifyWriter : public Print {
+public:
+  /** Writer on `chr` for a link with the given ATT MTU (>= 4). */
+  NotifyWriter(BLECharacteristic& chr, uint16_t attMtu);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+
+  /**
+   * Send the last partial packet and log notification count and bytes/s
+   * since startMs. False if any notification failed.
+   */
+  bool finish(unsigned long startMs);
+
+  /** False once a notification has failed. */
+  bool ok() const { return !failed; }
+
+  /** Payload bytes per notification in use. */
+  size_t packetBytes() const { return packetSize; }
+
+private:
+  void flushPacket();
+
+  BLECharacteristic& chr;
+  size_t   packetSize;
+  size_t   used;
+  size_t   bytes;
+  uint16_t notifications;
+  bool     failed;
+};
+
+#endif
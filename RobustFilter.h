@@ -0,0 +1,157 @@
+#ifndef ROBUST_FILTER_H
+#define ROBUST_FILTER_H
+
+#include <Arduino.h>
+
+// ============================================
+// STREAMING ROBUST FILTER
+// ============================================
+//
+// Sliding-window median over the newest N values, shared by every analog
+// channel (pH, TDS, the calibration stability windows). Replaces the
+// per-module "fill an array, insertion-sort it, take the middle" helpers.
+//
+// The window is kept twice: a ring in arrival order (to know which value
+// leaves) and a sorted copy. push() removes the departing value and inserts
+// the new one with a binary search and one memmove each, so an insert is
+// O(log N) compares + O(N) word moves, and median()/spread() are O(1). For
+// the N <= 64 used here that is a few hundred cycles, against O(N^2) for a
+// re-sort per read.
+//
+// Hampel spike rejection (hampelMean) averages the window after dropping any
+// value more than k scaled MADs from its median: spike-proof like the median,
+// but with the lower noise of a mean. The MAD is found in O(N) by merging the
+// two halves of the sorted window outwards from the median, so it needs no
+// sort. Nothing rejected is written back into the window, so a genuine step
+// still shows once it fills half of it.
+//
+// No heap; sizeof is ~2*N*sizeof(T) plus three bytes.
+
+template <uint8_t N, typename T = float>
+class RobustFilter {
+  static_assert(N >= 1, "RobustFilter needs a window of at least 1");
+
+public:
+  RobustFilter() { clear(); }
+
+  void clear() {
+    count = 0;
+    head  = 0;
+  }
+
+  uint8_t size() const { return count; }
+  bool    full() const { return count == N; }
+
+  /** Add a value, evicting the oldest once the window is full. */
+  void push(T x) {
+    if (count == N) {
+      T old = ring[head];
+      uint8_t i = lowerBound(old);
+      memmove(&sorted[i], &sorted[i + 1], (count - 1 - i) * sizeof(T));
+      count--;
+    }
+    uint8_t i = upperBound(x);
+    memmove(&sorted[i + 1], &sorted[i], (count - i) * sizeof(T));
+    sorted[i] = x;
+    count++;
+
+    ring[head] = x;
+    head = (uint8_t)((head + 1) % N);
+  }
+
+  /** Median of the window (mean of the middle pair for even sizes). 0 if empty. */
+  float median() const {
+    if (count == 0) return 0.0f;
+    if (count & 1) return (float)sorted[count / 2];
+    return ((float)sorted[count / 2 - 1] + (float)sorted[count / 2]) * 0.5f;
+  }
+
+  /** Peak-to-peak spread (max - min) of the window. */
+  float spread() const {
+    return count ? (float)sorted[count - 1] - (float)sorted[0] : 0.0f;
+  }
+
+  T minimum() const { return sorted[0]; }
+  T maximum() const { return sorted[count - 1]; }
+
+  /**
+   * Hampel-screened mean: the mean of the values within k * 1.4826 * MAD of
+   * the median (the median if the MAD is 0, i.e. most values are identical).
+   * Returns 0 if empty.
+   */
+  float hampelMean(float k = 3.0f) const {
+    if (count == 0) return 0.0f;
+    const float med = median();
+    const float lim = k * 1.4826f * medianAbsDeviation();
+    if (lim <= 0.0f) return med;
+    float   sum  = 0.0f;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (fabsf((float)sorted[i] - med) <= lim) {
+        sum += (float)sorted[i];
+        kept++;
+      }
+    }
+    return sum / kept;   // kept >= 1: at least half the window is within one MAD
+  }
+
+  /** Median absolute deviation from the median (unscaled). */
+  float medianAbsDeviation() const {
+    if (count < 2) return 0.0f;
+    const float med = median();
+
+    // Deviations grow outwards from the middle of the sorted window on both
+    // sides; merge the two runs and stop at the middle rank(s).
+    int lo = (count - 1) / 2;     // last index <= median
+    int hi = count / 2;           // first index >= median
+    if (lo == hi) { lo--; hi++; } // odd size: the median itself has deviation 0
+
+    const uint8_t target = (uint8_t)((count - 1) / 2);   // lower middle rank
+    uint8_t rank = (count & 1) ? 1 : 0;                  // odd: rank 0 already taken
+    while (true) {
+      float cur;
+      float dl = (lo >= 0)    ? med - (float)sorted[lo] : INFINITY;
+      float dh = (hi < count) ? (float)sorted[hi] - med : INFINITY;
+      if (dl <= dh) { cur = dl; lo--; }
+      else          { cur = dh; hi++; }
+      if (rank == target) {
+        if (count & 1) return cur;
+        // Even size: mean of ranks target and target + 1.
+        float dl2 = (lo >= 0)    ? med - (float)sorted[lo] : INFINITY;
+        float dh2 = (hi < count) ? (float)sorted[hi] - med : INFINITY;
+        return 0.5f * (cur + (dl2 < dh2 ? dl2 : dh2));
+      }
+      rank++;
+    }
+  }
+
+private:
+  T       ring[N];     // arrival order
+  T       sorted[N];   // ascending
+  uint8_t count;
+  uint8_t head;        // next ring slot (the oldest once full)
+
+  /** First index in sorted[0..count) whose value is >= x. */
+  uint8_t lowerBound(T x) const {
+    uint8_t a = 0, b = count;
+    while (a < b) {
+      uint8_t m = (uint8_t)((a + b) / 2);
+      if (sorted[m] < x) a = m + 1;
+      else               b = m;
+    }
+    return a;
+  }
+
+  /** First index in sorted[0..count) whose value is > x. */
+  uint8_t upperBound(T x) const {
+    uint8_t a = 0, b = count;
+    while (a < b) {
+      uint8_t m = (uint8_t)((a + b) / 2);
+      if (x < sorted[m]) b = m;
+      else               a = m + 1;
+    }
+    return a;
+  }
+};
+
+#endif
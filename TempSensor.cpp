@@ -0,0 +1,274 @@
+#include "TempSensor.h"
+#include <limits.h>
+
+#if TEMP_ONEWIRE_PIN >= 0 && !TEMP_SENSOR_SIMULATE
+#include <OneWire.h>
+#endif
+
+// ============================================
+// DS18B20 PROTOCOL
+// ============================================
+
+#define DS_CMD_CONVERT_T     0x44
+#define DS_CMD_READ_PAD      0xBE
+#define DS_CMD_WRITE_PAD     0x4E
+#define DS_PAD_LEN           9
+#define DS_RAW_POR           0x0550   // 85.000 degC: scratchpad never converted
+#define DS_CONVERT_MARGIN_MS 20       // past the datasheet maximum before giving up polling
+
+/** Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1), LSB first. */
+static uint8_t dsCrc8(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    uint8_t b = *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if (mix) crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return crc;
+}
+
+// ============================================
+// SIMULATED DEVICE
+// ============================================
+//
+// Byte-level stand-in for OneWire with a single DS18B20 on it. Only the calls
+// the driver below makes are emulated; a conversion latches the temperature
+// set by tempSimulateSet() and reports busy for the real conversion time.
+
+#if TEMP_SENSOR_SIMULATE
+
+class SimOneWire {
+public:
+  explicit SimOneWire(uint8_t) {
+    pad[2] = 0x4B; pad[3] = 0x46; pad[4] = 0x7F;   // DS18B20 power-on defaults
+    pad[5] = 0xFF; pad[6] = 0x0C; pad[7] = 0x10;
+    setRaw(DS_RAW_POR);
+  }
+
+  uint8_t reset() { finish(); cmd = 0; arg = 0; return 1; }
+  void    skip()  {}
+
+  void write(uint8_t v, uint8_t = 0) {
+    if (cmd == DS_CMD_WRITE_PAD) {                 // TH, TL, config follow
+      if (arg < 3) pad[2 + arg++] = v;
+      if (arg == 3) setRaw(rawValue);              // refresh CRC
+      return;
+    }
+    cmd = v;
+    arg = 0;
+    if (v == DS_CMD_CONVERT_T) {
+      convStartMs = millis();
+      converting  = true;
+    }
+  }
+
+  uint8_t read() {
+    if (cmd != DS_CMD_READ_PAD || arg >= DS_PAD_LEN) return 0xFF;
+    return pad[arg++];
+  }
+
+  uint8_t read_bit() {
+    finish();
+    return converting ? 0 : 1;
+  }
+
+  float simC = TEMP_SIMULATE_C;
+
+private:
+  uint8_t       pad[DS_PAD_LEN];
+  int16_t       rawValue;
+  uint8_t       cmd = 0, arg = 0;
+  bool          converting  = false;
+  unsigned long convStartMs = 0;
+
+  /** Latch the conversion result once its time is up (a real part does this unprompted). */
+  void finish() {
+    if (!converting || millis() - convStartMs < tempConversionMs()) return;
+    converting = false;
+    int16_t raw = (int16_t)lroundf(simC * 16.0f);
+    uint8_t dropBits = 3 - ((pad[4] >> 5) & 0x03);   // undefined low bits
+    setRaw((int16_t)(raw & ~((1 << dropBits) - 1)));
+  }
+
+  void setRaw(int16_t raw) {
+    rawValue = raw;
+    pad[0] = (uint8_t)(raw & 0xFF);
+    pad[1] = (uint8_t)((uint16_t)raw >> 8);
+    pad[8] = dsCrc8(pad, DS_PAD_LEN - 1);
+  }
+};
+
+typedef SimOneWire TempBus;
+
+#elif TEMP_ONEWIRE_PIN >= 0
+typedef OneWire TempBus;
+#endif
+
+// ============================================
+// STATE
+// ============================================
+
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+static TempBus bus(TEMP_ONEWIRE_PIN >= 0 ? TEMP_ONEWIRE_PIN : 0);
+#endif
+
+static bool          present      = false;
+static bool          pending      = false;
+static unsigned long convStartMs  = 0;
+static bool          haveReading  = false;
+static float         latestC      = TEMP_DEFAULT_C;
+static unsigned long latestAtMs   = 0;
+
+unsigned long tempConversionMs() {
+  return 750UL >> (12 - TEMP_RESOLUTION_BITS);
+}
+
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+
+// ============================================
+// BUS HELPERS
+// ============================================
+
+/** Done once the device releases the bus, or the datasheet time has passed. */
+static bool conversionDone() {
+  if (millis() - convStartMs >= tempConversionMs() + DS_CONVERT_MARGIN_MS) return true;
+  return bus.read_bit() == 1;
+}
+
+/** Read and validate the scratchpad. False on no presence, CRC or range error. */
+static bool readScratchpad(float& tempC) {
+  if (!bus.reset()) return false;
+  bus.skip();
+  bus.write(DS_CMD_READ_PAD);
+  uint8_t pad[DS_PAD_LEN];
+  for (uint8_t i = 0; i < DS_PAD_LEN; i++) pad[i] = bus.read();
+
+  if (dsCrc8(pad, DS_PAD_LEN - 1) != pad[8]) {
+    Serial.println("[Temp] Scratchpad CRC error.");
+    return false;
+  }
+
+  int16_t raw = (int16_t)(((uint16_t)pad[1] << 8) | pad[0]);
+  if (raw == DS_RAW_POR) return false;   // device reset mid-conversion
+  raw &= ~((1 << (12 - TEMP_RESOLUTION_BITS)) - 1);
+
+  float c = raw / 16.0f;
+  if (c < TEMP_MIN_VALID_C || c > TEMP_MAX_VALID_C) {
+    Serial.print("[Temp] Reading out of range: ");
+    Serial.println(c, 2);
+    return false;
+  }
+  tempC = c;
+  return true;
+}
+
+/** Finish the pending conversion: read it and, if valid, publish it. */
+static bool collect() {
+  pending = false;
+  float c;
+  if (!readScratchpad(c)) return false;
+  latestC     = c;
+  latestAtMs  = millis();
+  haveReading = true;
+  return true;
+}
+
+#endif
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool tempSensorInit() {
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+  present = bus.reset();
+  if (!present) {
+    Serial.print("[Temp] No 1-Wire device — using ");
+    Serial.print(TEMP_DEFAULT_C, 1);
+    Serial.println(" C.");
+    return false;
+  }
+
+  // TH/TL alarm bytes are unused; only the config byte matters.
+  bus.skip();
+  bus.write(DS_CMD_WRITE_PAD);
+  bus.write(0x4B);
+  bus.write(0x46);
+  bus.write((uint8_t)(((TEMP_RESOLUTION_BITS - 9) << 5) | 0x1F));
+
+  Serial.print("[Temp] DS18B20 found, ");
+  Serial.print(TEMP_RESOLUTION_BITS);
+  Serial.print("-bit (");
+  Serial.print(tempConversionMs());
+  Serial.println(" ms/conversion).");
+  tempStartConversion();
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool tempSensorPresent() {
+  return present;
+}
+
+void tempStartConversion() {
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+  if (!present || pending) return;
+  if (!bus.reset()) return;
+  bus.skip();
+  bus.write(DS_CMD_CONVERT_T);
+  convStartMs = millis();
+  pending     = true;
+#endif
+}
+
+bool tempConversionPending() {
+  return pending;
+}
+
+void tempSensorService() {
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+  if (!present) return;
+  if (pending) {
+    if (conversionDone()) collect();
+    return;
+  }
+  // Timed from the last START, so a failed read is retried no faster than
+  // a good one refreshes.
+  if (millis() - convStartMs >= TEMP_REFRESH_MS) tempStartConversion();
+#endif
+}
+
+bool tempCollect(unsigned long timeoutMs) {
+#if TEMP_ONEWIRE_PIN >= 0 || TEMP_SENSOR_SIMULATE
+  if (!present || !pending) return false;
+  unsigned long t0 = millis();
+  while (!conversionDone()) {
+    if (millis() - t0 >= timeoutMs) return false;
+    delay(5);
+  }
+  return collect();
+#else
+  (void)timeoutMs;
+  return false;
+#endif
+}
+
+float tempLatestC() {
+  return latestC;
+}
+
+unsigned long tempAgeMs() {
+  return haveReading ? millis() - latestAtMs : ULONG_MAX;
+}
+
+#if TEMP_SENSOR_SIMULATE
+void tempSimulateSet(float tempC) {
+  bus.simC = tempC;
+}
+#endif
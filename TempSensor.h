@@ -0,0 +1,107 @@
+#ifndef TEMP_SENSOR_H
+#define TEMP_SENSOR_H
+
+#include <Arduino.h>
+
+// ============================================
+// SAMPLE TEMPERATURE (DS18B20, 1-Wire)
+// ============================================
+//
+// A waterproof DS18B20 in the sample cup feeds temperature compensation in
+// voltageToPH() and voltageToEC(). A conversion takes up to 750 ms at 12 bits,
+// so this module NEVER waits for one in the normal flow:
+//
+//   tempStartConversion()  issues CONVERT T and returns at once (~1 ms of bus
+//                          traffic);
+//   tempSensorService()    called every loop pass, reads the scratchpad once
+//                          the device reports done, and starts the next
+//                          conversion every TEMP_REFRESH_MS while idle;
+//   tempLatestC()          returns the newest good reading without touching
+//                          the bus.
+//
+// startTest() kicks a fresh conversion as its very first action and collects
+// it after the pH endpoint and the TDS settle. If that conversion is still
+// running but the newest reading is younger than TEMP_REFRESH_MS, the test
+// uses that reading rather than wait; tempCollect() is the bounded wait for
+// when there is no recent reading at all.
+//
+// With no probe on the bus (no presence pulse at init) every reader gets
+// TEMP_DEFAULT_C, exactly as before this module existed.
+//
+// Wiring: DQ -> TEMP_ONEWIRE_PIN with a 4.7 k pull-up to 5 V; VDD to 5 V
+// (external power, not parasite: "done" is polled on the bus).
+
+// Digital pin carrying the 1-Wire bus. Set to -1 to build without a probe.
+#define TEMP_ONEWIRE_PIN        11
+
+// Conversion resolution, 9..12 bits (0.5 / 0.25 / 0.125 / 0.0625 degC).
+// Conversion time halves per bit dropped: 94 / 188 / 375 / 750 ms.
+#define TEMP_RESOLUTION_BITS    12
+
+// Background refresh period while idle. A cup of liquid changes temperature
+// over minutes, so this only needs to keep tempLatestC() from going stale.
+#define TEMP_REFRESH_MS       5000
+
+// Fallback when no probe is fitted or no reading has succeeded yet.
+#define TEMP_DEFAULT_C        25.0f
+
+// Plausible range for a sample cup. Anything outside (or the 85.000 degC
+// power-on-reset scratchpad value) is treated as a failed read.
+#define TEMP_MIN_VALID_C      -5.0f
+#define TEMP_MAX_VALID_C      60.0f
+
+// ---- Simulated device ----
+// 1 = replace the OneWire bus with an in-memory DS18B20 (presence, scratchpad,
+// CRC and conversion time all emulated) at TEMP_SIMULATE_C. The whole driver
+// path above the bit level runs unchanged, so the module can be exercised on a
+// bench without a probe, or compiled on a host with no OneWire library.
+// tempSimulateSet() moves the simulated reading at run time. The host harness
+// (test/host/temp_sensor_test.cpp) builds with -DTEMP_SENSOR_SIMULATE=1.
+#ifndef TEMP_SENSOR_SIMULATE
+  #define TEMP_SENSOR_SIMULATE   0
+#endif
+#define TEMP_SIMULATE_C       22.5f
+
+/**
+ * Probe the bus, program TEMP_RESOLUTION_BITS and start the first conversion.
+ * False if no device answered (the module then serves TEMP_DEFAULT_C).
+ */
+bool tempSensorInit();
+
+/** True if a device answered at init. */
+bool tempSensorPresent();
+
+/** Issue CONVERT T unless one is already running. Non-blocking. */
+void tempStartConversion();
+
+/** True while a conversion started by tempStartConversion() is outstanding. */
+bool tempConversionPending();
+
+/**
+ * Non-blocking housekeeping: collect a finished conversion, and start a new
+ * one once the newest reading is TEMP_REFRESH_MS old. Call every loop pass.
+ */
+void tempSensorService();
+
+/**
+ * Wait at most timeoutMs for the pending conversion and collect it. True if
+ * a fresh reading was stored (false with no probe, no pending conversion,
+ * timeout or a CRC failure; tempLatestC() then keeps the previous value).
+ */
+bool tempCollect(unsigned long timeoutMs);
+
+/** Newest valid temperature in degC, or TEMP_DEFAULT_C if there is none. */
+float tempLatestC();
+
+/** Age of tempLatestC() in ms, or ULONG_MAX if it is the default. */
+unsigned long tempAgeMs();
+
+/** Worst-case conversion time at TEMP_RESOLUTION_BITS, ms. */
+unsigned long tempConversionMs();
+
+#if TEMP_SENSOR_SIMULATE
+/** Set the temperature the simulated device reports from its next conversion. */
+void tempSimulateSet(float tempC);
+#endif
+
+#endif
@@ -9,11 +9,47 @@ uint16_t   camLastCalR = 0;
 uint16_t   camLastCalG = 0;
 uint16_t   camLastCalB = 0;
 bool       camOnline   = false;
+bool       camStreaming = false;
+CameraFrame camLastFrame = { { 0, 0, 0, false }, false, 0 };
+
+// Cached frames must have been captured after this moment (set by
+// cameraAwaitLightSettle() from the last illumination change).
+static unsigned long camSceneSince = 0;
 
 // ============================================
 // LOW-LEVEL UART HELPERS
 // ============================================
 
+// Line assembler shared by cameraPoll() and sendCommand(). A partial line
+// survives between calls, so a status push that straddles two polls is
+// completed on the next one instead of being dropped or misread.
+static char   rxLine[96];
+static size_t rxLen = 0;
+
+// Background bring-up (see INITIALISATION below).
+static void bringupStep();
+static void cameraAwaitBringup();
+
+/**
+ * Consume RX bytes until one complete line is assembled.
+ * Returns true with the line NUL-terminated in rxLine (valid until the next
+ * call), false once the RX buffer runs dry mid-line. '\r' is stripped and
+ * over-long lines are truncated but still consumed up to their '\n'.
+ */
+static bool readLine() {
+  while (CAM_SERIAL.available()) {
+    char c = (char)CAM_SERIAL.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      rxLine[rxLen] = '\0';
+      rxLen = 0;
+      return true;
+    }
+    if (rxLen < sizeof(rxLine) - 1) rxLine[rxLen++] = c;
+  }
+  return false;
+}
+
 /**
  * Drain any unread bytes sitting in the Serial1 RX buffer.
  * Called before sending a command so we don't pick up stale chatter
@@ -24,6 +60,51 @@ static void drainRx() {
   while (CAM_SERIAL.available()) CAM_SERIAL.read();
   delay(2);
   while (CAM_SERIAL.available()) CAM_SERIAL.read();
+  rxLen = 0;
+}
+
+/**
+ * If `line` is a keep-warm "ST,conv,r,g,b" push, fold it into camLastFrame
+ * and return true so the caller skips it. Malformed ST lines are swallowed.
+ */
+static bool handleStatusLine(const char* line) {
+  if (strncmp(line, "ST,", 3) != 0) return false;
+
+  unsigned int conv, r, g, b;
+  if (sscanf(line, "ST,%u,%u,%u,%u", &conv, &r, &g, &b) == 4) {
+    camLastFrame.rgb.r      = (uint8_t)(r > 255 ? 255 : r);
+    camLastFrame.rgb.g      = (uint8_t)(g > 255 ? 255 : g);
+    camLastFrame.rgb.b      = (uint8_t)(b > 255 ? 255 : b);
+    camLastFrame.rgb.valid  = true;
+    camLastFrame.converged  = (conv != 0);
+    camLastFrame.receivedAt = millis();
+  }
+  return true;
+}
+
+/**
+ * Wait up to timeoutMs for the next non-status line and copy it into
+ * `response` (truncated to responseLen - 1). On timeout the partial line, if
+ * any, is copied instead so callers can log it, and false is returned.
+ */
+static bool waitLine(char* response, size_t responseLen, unsigned long timeoutMs) {
+  unsigned long deadline = millis() + timeoutMs;
+
+  while ((long)(deadline - millis()) > 0) {
+    while (readLine()) {
+      if (handleStatusLine(rxLine)) continue;
+      strncpy(response, rxLine, responseLen - 1);
+      response[responseLen - 1] = '\0';
+      return true;
+    }
+    delay(2);
+  }
+
+  rxLine[rxLen] = '\0';
+  rxLen = 0;
+  strncpy(response, rxLine, responseLen - 1);
+  response[responseLen - 1] = '\0';
+  return false;
 }
 
 /**
@@ -33,136 +114,256 @@ static void drainRx() {
  * Returns true if a full line was received before the timeout, false otherwise.
  *
  * '\r' is silently stripped so the function works whether the peer sends
- * "OK\n" or "OK\r\n".
+ * "OK\n" or "OK\r\n". While streaming, pending status pushes are folded into
+ * the frame cache instead of being discarded (drainRx() would cut one in
+ * half), and any that arrive before the reply are skipped the same way.
  */
 static bool sendCommand(const char* cmd, char* response, size_t responseLen,
                         unsigned long timeoutMs) {
-  drainRx();
+  cameraAwaitBringup();   // never interleave with an in-flight bring-up PING
+
+  if (camStreaming) cameraPoll();
+  else              drainRx();
 
   CAM_SERIAL.print(cmd);
   CAM_SERIAL.print('\n');
   CAM_SERIAL.flush();
 
-  unsigned long deadline = millis() + timeoutMs;
-  size_t pos = 0;
+  return waitLine(response, responseLen, timeoutMs);
+}
 
-  while ((long)(deadline - millis()) > 0) {
-    while (CAM_SERIAL.available()) {
-      char c = (char)CAM_SERIAL.read();
+/**
+ * Ask the ESP32 to enter keep-warm mode. Firmware that doesn't know STREAM
+ * answers ERR, which leaves camStreaming false and every read on-demand.
+ */
+static void cameraStreamStart() {
+#if CAM_STREAM_ENABLE
+  char cmd[16];
+  char buf[32];
+  snprintf(cmd, sizeof(cmd), "STREAM,%u", (unsigned)CAM_STREAM_PERIOD_MS);
+  camStreaming = false;
+  camLastFrame.rgb.valid = false;
+  if (sendCommand(cmd, buf, sizeof(buf), CAM_PING_TIMEOUT_MS)
+      && strcmp(buf, "OK") == 0) {
+    camStreaming = true;
+    Serial.println("[Cam] Keep-warm streaming on.");
+  } else {
+    Serial.print("[Cam] STREAM not supported (");
+    Serial.print(buf);
+    Serial.println(") — using on-demand READ.");
+  }
+#endif
+}
 
-      if (c == '\r') continue;
-      if (c == '\n') {
-        response[pos] = '\0';
-        return true;
-      }
-      if (pos < responseLen - 1) {
-        response[pos++] = c;
-      }
-      // If the line is longer than our buffer, keep consuming until '\n'
-      // so the next call doesn't see leftover bytes.
-    }
-    delay(2);
+/**
+ * True when the cached keep-warm frame can stand in for a READ: streaming is
+ * on, AEC/AWB reported converged, the push is recent, and it was sent at
+ * least one push period after the last light change (so the frame it
+ * describes was exposed under the current light).
+ */
+static bool cachedFrameUsable() {
+  if (!camStreaming || !camLastFrame.rgb.valid || !camLastFrame.converged) {
+    return false;
   }
+  if (millis() - camLastFrame.receivedAt > CAM_STREAM_MAX_AGE_MS) return false;
+  return (long)(camLastFrame.receivedAt - (camSceneSince + CAM_STREAM_PERIOD_MS)) >= 0;
+}
 
-  response[pos] = '\0';
-  return false;
+void cameraPoll() {
+  if (cameraBringupPending()) {
+    bringupStep();
+    return;
+  }
+  while (readLine()) {
+    if (handleStatusLine(rxLine)) continue;
+    if (rxLine[0] != '\0') {
+      Serial.print("[Cam] Unsolicited: ");
+      Serial.println(rxLine);
+    }
+  }
 }
 
 // ============================================
-// INITIALISATION
+// INITIALISATION  (background bring-up)
 // ============================================
 //
-// IMPORTANT: this MUST be the first thing called in setup() (right after
-// Serial.begin). The ESP32-CAM emits its "READY" line ~1 second after
-// power-on. If Serial1 isn't open and being drained in real time before
-// then, the small hardware RX buffer (~256 B on R4) overflows mid-boot
-// and READY is dropped. That manifests as random "READY not received"
-// failures even though the ESP32 is fine.
+// Bring-up used to block setup() for up to ~11 s (8 s READY listen + four
+// PINGs with backoff). It now runs as a small state machine advanced by
+// cameraPoll() from setup() and loop(), so the rest of boot and the main menu
+// don't wait on the ESP32:
 //
-void cameraSensorInit() {
-  CAM_SERIAL.begin(CAM_BAUD);
+//   LISTEN — drain Serial1 in real time, echo boot chatter, wait for READY
+//            (or give up at CAM_BOOT_DELAY_MS)
+//   PROBE  — PING with CAM_PROBE_ATTEMPTS tries, CAM_PROBE_BACKOFF_MS apart
+//   DONE   — camOnline settled; keep-warm streaming armed if supported
+//
+// The READY listener still has to drain the RX buffer as it fills (the small
+// hardware buffer overflows mid-boot otherwise and READY is lost), which is
+// why cameraPoll() must be called often while cameraBringupPending().
+
+enum CamBringup {
+  CAM_BRINGUP_IDLE = 0,   // cameraSensorBegin() not called yet
+  CAM_BRINGUP_LISTEN,
+  CAM_BRINGUP_PROBE,
+  CAM_BRINGUP_DONE
+};
+
+static CamBringup    bringup          = CAM_BRINGUP_IDLE;
+static unsigned long bringupStartedAt = 0;
+static unsigned long bringupDeadline  = 0;   // READY deadline, then PONG deadline
+static unsigned long bringupNextProbe = 0;
+static uint8_t       bringupAttempt   = 0;
+static bool          pingOutstanding  = false;
+
+static void enterProbe() {
+  drainRx();   // drop any boot fragment so the first PONG line is clean
+  bringup          = CAM_BRINGUP_PROBE;
+  bringupAttempt   = 0;
+  bringupNextProbe = millis();
+  pingOutstanding  = false;
+}
 
-  // Default Stream timeout is 1000 ms. We never want to block that long
-  // on a partial read. (We don't actually use readStringUntil below — we
-  // parse byte-by-byte — but other callers might.)
-  CAM_SERIAL.setTimeout(50);
+static void finishBringup(bool ok) {
+  bringup   = CAM_BRINGUP_DONE;
+  camOnline = ok;
 
-  // ---- Phase 1: opportunistic READY listen ----
-  //
-  // Parse byte-by-byte: this lets us drain the boot stream as fast as it
-  // arrives, never letting the hardware buffer fill up.
-  //
-  // We also echo any non-READY lines to the main Serial monitor — if the
-  // ESP32 fails to bring up its camera (typical brownout symptom) it will
-  // print "ERR,camera_init_failed" before READY, and that should be visible.
-  unsigned long deadline = millis() + 8000UL;
-  bool gotReady = false;
-  String linebuf = "";
-
-  while ((long)(deadline - millis()) > 0 && !gotReady) {
-    while (CAM_SERIAL.available()) {
-      char c = (char)CAM_SERIAL.read();
-      if (c == '\r') continue;
-      if (c == '\n') {
-        linebuf.trim();
-        if (linebuf == "READY") { gotReady = true; break; }
-        if (linebuf.length() > 0) {
-          Serial.print("[Cam boot] ");
-          Serial.println(linebuf);
-        }
-        linebuf = "";
-      } else if (linebuf.length() < 96) {
-        linebuf += c;
-      }
-    }
-    delay(5);
+  if (ok) {
+    Serial.print("[Cam] ESP32-CAM online (PING/PONG OK) after ");
+    Serial.print(millis() - bringupStartedAt);
+    Serial.println(" ms.");
+    cameraStreamStart();
+  } else {
+    Serial.println("[Cam] WARNING: ESP32-CAM did not respond to PING.");
+    Serial.println("[Cam] If you see other sensor LEDs dim around now, that's a");
+    Serial.println("[Cam] POWER symptom — the ESP32-CAM peaks at ~600 mA during");
+    Serial.println("[Cam] boot/capture and will brown out the Arduino 5V rail.");
+    Serial.println("[Cam] Use a separate 5V (>=1A) supply for the ESP32-CAM with");
+    Serial.println("[Cam] a common ground. No software fix can compensate for it.");
   }
+}
 
-  if (gotReady) {
-    Serial.println("[Cam] ESP32-CAM sent READY.");
-  } else {
-    Serial.println("[Cam] READY not received in time — falling back to PING probe.");
+/**
+ * Advance the bring-up state machine by one non-blocking step.
+ */
+static void bringupStep() {
+  unsigned long now = millis();
+
+  if (bringup == CAM_BRINGUP_LISTEN) {
+    // We also echo any non-READY lines to the main Serial monitor — if the
+    // ESP32 fails to bring up its camera (typical brownout symptom) it will
+    // print "ERR,camera_init_failed" before READY, and that should be visible.
+    while (readLine()) {
+      if (strcmp(rxLine, "READY") == 0) {
+        Serial.println("[Cam] ESP32-CAM sent READY.");
+        enterProbe();
+        return;
+      }
+      if (rxLine[0] != '\0') {
+        Serial.print("[Cam boot] ");
+        Serial.println(rxLine);
+      }
+    }
+    if ((long)(now - bringupDeadline) >= 0) {
+      Serial.println("[Cam] READY not received in time — falling back to PING probe.");
+      enterProbe();
+    }
+    return;
   }
 
-  // ---- Phase 2: drain residual bytes ----
-  // Catch anything that landed after READY (or any leftover boot fragment)
-  // so the first PING response line isn't polluted.
-  drainRx();
+  if (bringup != CAM_BRINGUP_PROBE) return;
 
-  // ---- Phase 3: probe with retries ----
-  //
   // A single PING failure right after boot is not a reliable signal that
   // the ESP32 is dead. The camera driver may still be settling, or the
   // board may have just recovered from a brief brownout. Retry several
   // times with backoff before giving up.
-  bool ok = false;
-  for (int attempt = 0; attempt < 4 && !ok; attempt++) {
-    if (attempt > 0) {
+  if (!pingOutstanding) {
+    if ((long)(now - bringupNextProbe) < 0) return;
+    if (bringupAttempt > 0) {
       Serial.print("[Cam] Retrying PING (");
-      Serial.print(attempt + 1);
-      Serial.println("/4)...");
-      delay(750);
+      Serial.print(bringupAttempt + 1);
+      Serial.print('/');
+      Serial.print(CAM_PROBE_ATTEMPTS);
+      Serial.println(")...");
     }
-    ok = cameraIsReady();
+    drainRx();
+    CAM_SERIAL.print("PING\n");
+    pingOutstanding = true;
+    bringupDeadline = now + CAM_PING_TIMEOUT_MS;
+    bringupAttempt++;
+    return;
   }
 
-  if (ok) {
-    Serial.println("[Cam] ESP32-CAM online (PING/PONG OK).");
-  } else {
-    Serial.println("[Cam] WARNING: ESP32-CAM did not respond to PING.");
-    Serial.println("[Cam] If you see other sensor LEDs dim around now, that's a");
-    Serial.println("[Cam] POWER symptom — the ESP32-CAM peaks at ~600 mA during");
-    Serial.println("[Cam] boot/capture and will brown out the Arduino 5V rail.");
-    Serial.println("[Cam] Use a separate 5V (>=1A) supply for the ESP32-CAM with");
-    Serial.println("[Cam] a common ground. No software fix can compensate for it.");
+  while (readLine()) {
+    if (strcmp(rxLine, "PONG") == 0) {
+      pingOutstanding = false;
+      finishBringup(true);
+      return;
+    }
+  }
+  if ((long)(now - bringupDeadline) >= 0) {
+    pingOutstanding = false;
+    if (bringupAttempt >= CAM_PROBE_ATTEMPTS) {
+      finishBringup(false);
+    } else {
+      bringupNextProbe = now + CAM_PROBE_BACKOFF_MS;
+    }
+  }
+}
+
+/**
+ * Block until bring-up has settled. Used by anything that needs the camera
+ * right now (a test started seconds after boot, a calibration capture).
+ * Skips the rest of the READY wait — a PING answers just as well.
+ */
+static void cameraAwaitBringup() {
+  if (!cameraBringupPending()) return;
+  if (bringup == CAM_BRINGUP_LISTEN) {
+    Serial.println("[Cam] Camera needed before READY — probing now.");
+    enterProbe();
+  }
+  while (cameraBringupPending()) {
+    bringupStep();
+    delay(2);
   }
 }
 
+// IMPORTANT: call this as early in setup() as possible (right after
+// Serial.begin). The ESP32-CAM emits its "READY" line ~1 second after
+// power-on; Serial1 must be open and drained from then on.
+void cameraSensorBegin() {
+  CAM_SERIAL.begin(CAM_BAUD);
+
+  // Default Stream timeout is 1000 ms. We never want to block that long
+  // on a partial read. (Lines are parsed byte-by-byte; only the thumbnail
+  // relay uses readBytes(), and it only asks for bytes already available.)
+  CAM_SERIAL.setTimeout(50);
+
+  camOnline        = false;
+  bringup          = CAM_BRINGUP_LISTEN;
+  bringupStartedAt = millis();
+  bringupDeadline  = bringupStartedAt + CAM_BOOT_DELAY_MS;
+  rxLen            = 0;
+}
+
+bool cameraBringupPending() {
+  return bringup == CAM_BRINGUP_LISTEN || bringup == CAM_BRINGUP_PROBE;
+}
+
 bool cameraIsReady() {
+  if (cameraBringupPending()) {
+    cameraAwaitBringup();
+    return camOnline;
+  }
+
   char buf[32];
+  bool wasOnline = camOnline;
   bool ok = sendCommand("PING", buf, sizeof(buf), CAM_PING_TIMEOUT_MS)
             && strcmp(buf, "PONG") == 0;
   camOnline = ok;
+
+  // Coming (back) online — the ESP32 may have rebooted and lost keep-warm
+  // mode, so (re-)arm it.
+  if (ok && !wasOnline) cameraStreamStart();
   return ok;
 }
 
@@ -178,6 +379,18 @@ CameraRGB cameraRead() {
   // (e.g. user fixed power, or a transient brownout passed) mid-session.
   if (!camOnline && !cameraIsReady()) return out;
 
+  // Keep-warm path: serve the cached frame when it is fresh and converged.
+  if (camStreaming) {
+    cameraPoll();
+    if (cachedFrameUsable()) return camLastFrame.rgb;
+
+    // Streaming but no push for a while — the ESP32 probably rebooted
+    // without us noticing. Re-arm it, then fall through to a normal READ.
+    if (millis() - camLastFrame.receivedAt > CAM_STREAM_MAX_AGE_MS) {
+      cameraStreamStart();
+    }
+  }
+
   char buf[64];
 
   // Retry the READ a few times before declaring failure. A timeout AND a
@@ -215,6 +428,157 @@ CameraRGB cameraRead() {
   return out;
 }
 
+void cameraAwaitLightSettle(unsigned long lightChangedAt) {
+  camSceneSince = lightChangedAt;
+
+  if (camStreaming) {
+    unsigned long deadline = millis() + CAM_STREAM_CONVERGE_TIMEOUT_MS;
+    while ((long)(deadline - millis()) > 0) {
+      cameraPoll();
+      if (cachedFrameUsable()) return;
+      delay(5);
+    }
+    Serial.println("[Cam] No converged frame after light change — READ will warm up.");
+    return;
+  }
+
+  // On-demand mode: only wait out whatever part of the settle window has
+  // not already passed since the LEDs changed.
+  unsigned long elapsed = millis() - lightChangedAt;
+  if (elapsed < CAM_LIGHT_SETTLE_MS) delay(CAM_LIGHT_SETTLE_MS - elapsed);
+}
+
+// ============================================
+// THUMBNAIL RELAY
+// ============================================
+//
+// UART → BLE with a single CAM_THUMB_CHUNK_BYTES buffer. Flow control runs
+// both ways: the ESP32 won't send chunk N+1 until we ACK chunk N, and we
+// don't ACK until the BLE sink has accepted it (the sink paces itself on the
+// radio's buffer availability). So the RX ring never holds more than one
+// chunk and nothing is ever buffered beyond it.
+
+static uint8_t thumbBuf[CAM_THUMB_CHUNK_BYTES];
+
+/**
+ * Read exactly `len` raw bytes into thumbBuf, tracking the RX high-water mark.
+ */
+static bool readThumbBytes(size_t len, uint16_t& peakRx) {
+  unsigned long deadline = millis() + CAM_THUMB_CHUNK_TIMEOUT_MS;
+  size_t got = 0;
+
+  while (got < len) {
+    int avail = CAM_SERIAL.available();
+    if (avail > (int)peakRx) peakRx = (uint16_t)avail;
+    if (avail > 0) {
+      got += CAM_SERIAL.readBytes(thumbBuf + got, min((size_t)avail, len - got));
+    } else if ((long)(deadline - millis()) <= 0) {
+      return false;
+    } else {
+      delay(1);
+    }
+  }
+  return true;
+}
+
+/**
+ * Send ABORT and discard whatever the ESP32 still puts on the wire. A chunk
+ * already started is finished back to back (up to CAM_THUMB_CHUNK_BYTES plus
+ * its header, ~12 ms at CAM_BAUD), longer than drainRx()'s settle pass, so
+ * drain until the line has been idle for CAM_THUMB_QUIET_MS instead.
+ */
+static void abortThumb() {
+  CAM_SERIAL.print("ABORT\n");
+  unsigned long deadline   = millis() + CAM_THUMB_CHUNK_TIMEOUT_MS;
+  unsigned long quietSince = millis();
+  while ((long)(deadline - millis()) > 0) {
+    if (CAM_SERIAL.available()) {
+      while (CAM_SERIAL.available()) CAM_SERIAL.read();
+      quietSince = millis();
+    } else if (millis() - quietSince >= CAM_THUMB_QUIET_MS) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  rxLen = 0;
+}
+
+CamThumbStats cameraRelayThumbnail(const CamThumbSink& sink) {
+  CamThumbStats st = { false, 0, 0, 0, 0 };
+  unsigned long t0 = millis();
+
+  if (!camOnline && !cameraIsReady()) {
+    Serial.println("[Cam] Thumbnail: ESP32-CAM offline.");
+    sink.end(false);
+    return st;
+  }
+
+  char cmd[16];
+  char buf[32];
+  snprintf(cmd, sizeof(cmd), "THUMB,%u", (unsigned)CAM_THUMB_CHUNK_BYTES);
+
+  unsigned long total = 0;
+  if (!sendCommand(cmd, buf, sizeof(buf), CAM_READ_TIMEOUT_MS)
+      || sscanf(buf, "JPG,%lu", &total) != 1
+      || total == 0 || total > CAM_THUMB_MAX_BYTES) {
+    Serial.print("[Cam] THUMB failed: ");
+    Serial.println(buf);
+    sink.end(false);
+    return st;
+  }
+
+  // The ESP32 streams its first chunk right after the JPG line; abortThumb()
+  // flushes it. No end(): a sink that refused begin() has nothing to close.
+  if (!sink.begin((uint32_t)total)) {
+    Serial.println("[Cam] Thumbnail: sink refused transfer.");
+    abortThumb();
+    return st;
+  }
+
+  while (st.bytes < total) {
+    unsigned int seq, len;
+    if (!waitLine(buf, sizeof(buf), CAM_THUMB_CHUNK_TIMEOUT_MS)
+        || sscanf(buf, "C,%u,%u", &seq, &len) != 2
+        || len == 0 || len > CAM_THUMB_CHUNK_BYTES
+        || st.bytes + len > total) {
+      Serial.print("[Cam] Thumbnail: bad chunk header: ");
+      Serial.println(buf);
+      break;
+    }
+    if (!readThumbBytes(len, st.peakRxBytes)) {
+      Serial.println("[Cam] Thumbnail: chunk timed out.");
+      break;
+    }
+    if (!sink.chunk(thumbBuf, len)) {
+      Serial.println("[Cam] Thumbnail: sink rejected chunk (link lost?).");
+      break;
+    }
+    st.bytes += len;
+    st.chunks++;
+
+    snprintf(cmd, sizeof(cmd), "ACK,%u", seq);
+    CAM_SERIAL.print(cmd);
+    CAM_SERIAL.print('\n');
+  }
+
+  st.ok = (st.bytes == total);
+  if (!st.ok) abortThumb();
+  sink.end(st.ok);
+  st.elapsedMs = millis() - t0;
+
+  Serial.print("[Cam] Thumbnail ");
+  Serial.print(st.ok ? "relayed: " : "ABORTED after ");
+  Serial.print(st.bytes); Serial.print('/'); Serial.print(total);
+  Serial.print(" B, "); Serial.print(st.chunks);
+  Serial.print(" chunks in "); Serial.print(st.elapsedMs); Serial.print(" ms (");
+  Serial.print(st.elapsedMs ? (st.bytes * 1000UL) / st.elapsedMs : 0);
+  Serial.print(" B/s), peak RX "); Serial.print(st.peakRxBytes);
+  Serial.print(" B, relay buffer "); Serial.print(sizeof(thumbBuf));
+  Serial.println(" B.");
+  return st;
+}
+
 // ============================================
 // CALIBRATION
 // ============================================
@@ -239,54 +603,82 @@ static bool parseOkRGB(const char* buf, uint16_t& r, uint16_t& g, uint16_t& b) {
   return true;
 }
 
-void camCalCapture() {
+// In-flight CAL_DARK / CAL_WHITE started by camCalCaptureStart().
+static bool          calCmdPending  = false;
+static unsigned long calCmdDeadline = 0;
+
+bool camCalCaptureStart() {
   if (!camOnline && !cameraIsReady()) {
     Serial.println("[Cam] Cannot capture — ESP32-CAM offline.");
-    return;
+    return false;
   }
 
-  char buf[64];
-  uint16_t r, g, b;
-
+  const char* cmd;
   switch (camCalStep) {
-    case CAM_CAL_DARK:
-      if (sendCommand("CAL_DARK", buf, sizeof(buf), CAM_CAL_TIMEOUT_MS)
-          && parseOkRGB(buf, r, g, b)) {
-        camLastCalR = r; camLastCalG = g; camLastCalB = b;
-        Serial.print("[Cam] Dark captured: R="); Serial.print(r);
-        Serial.print(" G="); Serial.print(g);
-        Serial.print(" B="); Serial.println(b);
-        Serial.println("[Cam] Step 2: Show a white reference, then CAPTURE.");
-        camCalStep = CAM_CAL_WHITE;
-      } else {
-        Serial.print("[Cam] CAL_DARK failed: ");
-        Serial.println(buf);
-      }
-      break;
-
-    case CAM_CAL_WHITE:
-      if (sendCommand("CAL_WHITE", buf, sizeof(buf), CAM_CAL_TIMEOUT_MS)
-          && parseOkRGB(buf, r, g, b)) {
-        camLastCalR = r; camLastCalG = g; camLastCalB = b;
-        Serial.print("[Cam] White captured: R="); Serial.print(r);
-        Serial.print(" G="); Serial.print(g);
-        Serial.print(" B="); Serial.println(b);
-        Serial.println("[Cam] Both points captured. Press SELECT to save.");
-        camCalStep = CAM_CAL_DONE;
-      } else {
-        Serial.print("[Cam] CAL_WHITE failed: ");
-        Serial.println(buf);
-      }
-      break;
-
+    case CAM_CAL_DARK:  cmd = "CAL_DARK";  break;
+    case CAM_CAL_WHITE: cmd = "CAL_WHITE"; break;
     case CAM_CAL_DONE:
       Serial.println("[Cam] Already done — call camCalSave() or camCalBegin().");
-      break;
-
+      return false;
     default:
       Serial.println("[Cam] camCalCapture() called outside calibration sequence.");
-      break;
+      return false;
+  }
+
+  // Same preamble as sendCommand(), minus the wait for the reply.
+  if (camStreaming) cameraPoll();
+  else              drainRx();
+  CAM_SERIAL.print(cmd);
+  CAM_SERIAL.print('\n');
+  CAM_SERIAL.flush();
+
+  calCmdPending  = true;
+  calCmdDeadline = millis() + CAM_CAL_TIMEOUT_MS;
+  return true;
+}
+
+bool camCalCaptureFinish() {
+  if (!calCmdPending) return false;
+  calCmdPending = false;
+
+  char buf[64];
+  // Floor the wait so a reply that arrived while the caller was busy still
+  // gets read even if the deadline has just passed.
+  long remaining = (long)(calCmdDeadline - millis());
+  bool got = waitLine(buf, sizeof(buf), remaining > 20 ? (unsigned long)remaining : 20);
+  uint16_t r, g, b;
+  bool ok = got && parseOkRGB(buf, r, g, b);
+
+  if (camCalStep == CAM_CAL_DARK) {
+    if (ok) {
+      camLastCalR = r; camLastCalG = g; camLastCalB = b;
+      Serial.print("[Cam] Dark captured: R="); Serial.print(r);
+      Serial.print(" G="); Serial.print(g);
+      Serial.print(" B="); Serial.println(b);
+      Serial.println("[Cam] Step 2: Show a white reference, then CAPTURE.");
+      camCalStep = CAM_CAL_WHITE;
+    } else {
+      Serial.print("[Cam] CAL_DARK failed: ");
+      Serial.println(buf);
+    }
+  } else if (camCalStep == CAM_CAL_WHITE) {
+    if (ok) {
+      camLastCalR = r; camLastCalG = g; camLastCalB = b;
+      Serial.print("[Cam] White captured: R="); Serial.print(r);
+      Serial.print(" G="); Serial.print(g);
+      Serial.print(" B="); Serial.println(b);
+      Serial.println("[Cam] Both points captured. Press SELECT to save.");
+      camCalStep = CAM_CAL_DONE;
+    } else {
+      Serial.print("[Cam] CAL_WHITE failed: ");
+      Serial.println(buf);
+    }
   }
+  return ok;
+}
+
+void camCalCapture() {
+  if (camCalCaptureStart()) camCalCaptureFinish();
 }
 
 void camCalSave() {
@@ -23,21 +23,45 @@
 //   CAL_SAVE          → OK
 //   CAL_RESET         → OK
 //   CAL_GET           → CAL,dR,dG,dB,wR,wG,wB,valid
+//   STREAM,<ms>       → OK             (keep-warm mode on, push every <ms>)
+//   STREAM,0          → OK             (keep-warm mode off)
+//   THUMB,<chunk>     → JPG,<size>     (JPEG thumbnail of the last frame,
+//                                       then the chunked transfer below)
 //
 // On any failure the ESP32 replies "ERR,<reason>".
+//
+// While keep-warm streaming is on the ESP32 also pushes, unsolicited:
+//   ST,conv,r,g,b     conv = 1 once AEC/AWB has converged on the current
+//                     scene, r/g/b = calibrated ROI mean of the latest frame.
+// These lines can arrive at any time, including between a command and its
+// response, so every reader routes "ST," lines into the frame cache and keeps
+// waiting for the real reply.
+//
+// Thumbnail transfer (after JPG,<size>): the ESP32 sends one chunk at a time,
+//   C,<seq>,<len>\n  followed by exactly <len> raw JPEG bytes (len <= chunk)
+// and then waits for "ACK,<seq>" before sending the next one. The Arduino
+// only ACKs once the chunk has been handed to BLE, so at most one chunk is
+// ever in flight on the UART. "ABORT" ends the transfer early.
 // ============================================
 
 // ---- Hardware: which Arduino UART talks to the ESP32 ----
 // Arduino UNO R4 WiFi: Serial1 = pins 0 (RX) / 1 (TX) — hardware UART.
-#define CAM_SERIAL          Serial1
+// (The host harness in test/host substitutes a simulated ESP32 here.)
+#ifndef CAM_SERIAL
+  #define CAM_SERIAL        Serial1
+#endif
 #define CAM_BAUD            115200
 
 // ---- Timeouts (ms) ----
-#define CAM_BOOT_DELAY_MS   8000   // ESP32 cold-boot grace period
+#define CAM_BOOT_DELAY_MS   8000   // ESP32 cold-boot grace period (READY listen)
 #define CAM_PING_TIMEOUT_MS 1000
 #define CAM_READ_TIMEOUT_MS 4000   // capture + frame settle on ESP32 side
 #define CAM_CAL_TIMEOUT_MS  5000
 
+// ---- Bring-up probe ----
+#define CAM_PROBE_ATTEMPTS    4     // PINGs before declaring the camera offline
+#define CAM_PROBE_BACKOFF_MS  750   // gap between PING attempts
+
 // ---- Illumination settle (ms) ----
 // The ESP32-CAM is lit by the EXTERNAL white LEDs, which are switched OFF while
 // the AS7341 reads and back ON for the camera (see startTest / the calibration
@@ -53,6 +77,10 @@
 // is entirely for the camera's AEC/AWB to settle). Raise it if camera colours
 // still drift on the first read after the lights come on; lower it if the extra
 // latency per test/calibration matters more than that margin.
+//
+// The wait is applied by cameraAwaitLightSettle(), which only sleeps for the
+// part of this window not already elapsed since the LEDs last changed, and
+// skips it entirely once the keep-warm stream (below) reports convergence.
 #define CAM_LIGHT_SETTLE_MS  500
 
 // ---- READ robustness ----
@@ -60,10 +88,35 @@
 // reliable signal that the camera is unavailable — the ESP32 may have just
 // recovered from a transient brownout, or a UART byte got mangled. Retry a
 // few times before declaring the camera offline, mirroring the PING-probe
-// philosophy in cameraSensorInit().
+// philosophy of the bring-up probe.
 #define CAM_READ_RETRIES        3      // READ attempts before giving up
 #define CAM_READ_RETRY_DELAY_MS 150    // backoff between attempts
 
+// ---- Keep-warm streaming ----
+// The external LEDs are lit at idle most of the time, so instead of waking the
+// OV3660 for every READ (warm-up frames + CAM_LIGHT_SETTLE_MS) we ask the
+// ESP32 to keep capturing continuously and push an "ST," status every
+// CAM_STREAM_PERIOD_MS. cameraRead() then answers from the cached frame when
+// it is recent, converged, and was taken after the last light change —
+// otherwise it falls back to the on-demand READ above. ESP32 firmware without
+// STREAM support replies ERR and the sketch simply stays in on-demand mode.
+#ifndef CAM_STREAM_ENABLE
+  #define CAM_STREAM_ENABLE          1
+#endif
+#define CAM_STREAM_PERIOD_MS         200    // ESP32 status push interval
+#define CAM_STREAM_MAX_AGE_MS        (3 * CAM_STREAM_PERIOD_MS)  // cache freshness limit
+#define CAM_STREAM_CONVERGE_TIMEOUT_MS 1500 // max wait for "converged" after a light change
+
+// ---- Thumbnail relay ----
+// The R4 can't hold a JPEG (32 KB SRAM), so the thumbnail is relayed one
+// UART chunk at a time straight to the BLE sink; CAM_THUMB_CHUNK_BYTES is the
+// relay's only buffer. Keep it well under the R4's Serial1 RX ring so a whole
+// chunk plus its header always fits even if the loop is briefly late.
+#define CAM_THUMB_CHUNK_BYTES       128
+#define CAM_THUMB_MAX_BYTES         16384   // reject absurd sizes from a confused peer
+#define CAM_THUMB_CHUNK_TIMEOUT_MS  2000    // per-chunk UART deadline
+#define CAM_THUMB_QUIET_MS          5       // idle line after ABORT = chunk finished (~58 byte times)
+
 // ============================================
 // DATA STRUCTURES
 // ============================================
@@ -79,6 +132,42 @@ struct CameraRGB {
   bool    valid;
 };
 
+/**
+ * Latest keep-warm frame pushed by the ESP32 (see "ST," above).
+ * `receivedAt` is the millis() stamp when the status line was parsed;
+ * `rgb.valid` is false until the first status arrives.
+ */
+struct CameraFrame {
+  CameraRGB     rgb;
+  bool          converged;
+  unsigned long receivedAt;
+};
+
+/**
+ * Destination for a relayed thumbnail. begin() gets the total JPEG size,
+ * chunk() each piece in order (return false to abort, e.g. link lost), and
+ * end() the final outcome. If begin() returns false, end() is not called. Kept as plain function pointers so the camera
+ * module doesn't depend on the BLE module.
+ */
+struct CamThumbSink {
+  bool (*begin)(uint32_t totalBytes);
+  bool (*chunk)(const uint8_t* data, size_t len);
+  void (*end)(bool ok);
+};
+
+/**
+ * Outcome of cameraRelayThumbnail(). peakRxBytes is the fullest the Serial1
+ * RX buffer got while waiting on a chunk — the measure of how close the
+ * relay came to dropping bytes.
+ */
+struct CamThumbStats {
+  bool          ok;
+  uint32_t      bytes;
+  uint16_t      chunks;
+  unsigned long elapsedMs;
+  uint16_t      peakRxBytes;
+};
+
 // ============================================
 // CALIBRATION STATE MACHINE
 // ============================================
@@ -101,21 +190,35 @@ extern uint16_t camLastCalR;
 extern uint16_t camLastCalG;
 extern uint16_t camLastCalB;
 
-// Tracks whether the ESP32-CAM responded during init.
+// Tracks whether the ESP32-CAM responded during bring-up.
 // If false, all camera reads will return valid=false and the test routine
-// can quietly skip the camera block instead of stalling.
+// can quietly skip the camera block instead of stalling. Stays false until
+// the background bring-up finishes — check cameraBringupPending() to tell
+// "still starting" from "offline".
 extern bool camOnline;
 
+// True once the ESP32 acknowledged STREAM; the frame cache is only trusted
+// while this is set.
+extern bool camStreaming;
+extern CameraFrame camLastFrame;
+
 // ============================================
 // CORE FUNCTIONS
 // ============================================
 
 /**
- * Open Serial1 at CAM_BAUD, wait for the ESP32 to finish booting, and
- * confirm it responds to PING. Sets camOnline accordingly.
- * Safe to call even if the ESP32 isn't connected.
+ * Open Serial1 at CAM_BAUD and start the background bring-up (READY listen,
+ * then PING probe). Returns immediately; cameraPoll() advances it and sets
+ * camOnline once the handshake settles. Safe even if the ESP32 isn't
+ * connected. Anything that needs the camera before then (cameraRead, a
+ * calibration capture) finishes the bring-up synchronously first.
+ */
+void cameraSensorBegin();
+
+/**
+ * True while the background bring-up is still running.
  */
-void cameraSensorInit();
+bool cameraBringupPending();
 
 /**
  * Send a PING and return true if PONG comes back within the timeout.
@@ -129,6 +232,34 @@ bool cameraIsReady();
  */
 CameraRGB cameraRead();
 
+/**
+ * Non-blocking: drain whatever the ESP32 has sent and fold any "ST," status
+ * lines into camLastFrame. While bring-up is pending it advances that state
+ * machine instead. Call from loop() (and between boot steps) so the RX
+ * buffer never backs up.
+ */
+void cameraPoll();
+
+/**
+ * Replacement for a fixed delay(CAM_LIGHT_SETTLE_MS) after switching the
+ * external LEDs. `lightChangedAt` is illuminatorLastChangeMs().
+ *
+ * Streaming: returns as soon as a converged status taken after the light
+ * change arrives (usually immediately when the LEDs were already on), up to
+ * CAM_STREAM_CONVERGE_TIMEOUT_MS. Otherwise: waits only the part of
+ * CAM_LIGHT_SETTLE_MS that has not already elapsed since the change.
+ * Either way, later cameraRead() calls ignore cached frames older than it.
+ */
+void cameraAwaitLightSettle(unsigned long lightChangedAt);
+
+/**
+ * Ask the ESP32 for a JPEG thumbnail of the last frame it captured and relay
+ * it chunk-by-chunk to `sink` without ever holding the whole image. Blocks
+ * for the duration of the transfer; logs size, time, throughput and peak
+ * buffer use to Serial.
+ */
+CamThumbStats cameraRelayThumbnail(const CamThumbSink& sink);
+
 // ============================================
 // CALIBRATION
 // ============================================
@@ -145,6 +276,17 @@ void camCalBegin();
  */
 void camCalCapture();
 
+/**
+ * Split form of camCalCapture() so other work can overlap the ESP32's
+ * warm-up + capture (~1 s): camCalCaptureStart() sends CAL_DARK/CAL_WHITE for
+ * the current step and returns at once; camCalCaptureFinish() waits for the
+ * reply (within CAM_CAL_TIMEOUT_MS of the start), advances the state machine
+ * exactly as camCalCapture() would, and returns true on success.
+ * Nothing else may talk to the camera in between.
+ */
+bool camCalCaptureStart();
+bool camCalCaptureFinish();
+
 /**
  * Persist the calibration on the ESP32 (only valid when state == DONE).
  * Returns the state machine to IDLE on success.
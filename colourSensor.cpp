@@ -16,6 +16,13 @@ static DFRobot_AS7341 as7341;
 // loops fast and flicker-free.
 static bool onboardLedOn = false;
 
+// External illuminator state. illuminatorOn()/Off() are called every pass of
+// the live screens, so only a real change of light level (off→on, on→off, or
+// a brightness change while lit) stamps illumChangedAt. The camera uses that
+// stamp to decide how much of its AEC/AWB settle has already elapsed.
+static bool          illumLit       = false;
+static unsigned long illumChangedAt = 0;
+
 // ============================================
 // RAW STATUS READ  (saturation flags the library does not expose)
 // ============================================
@@ -1104,14 +1111,31 @@ void illuminatorInit() {
 void illuminatorOn() {
   analogWrite(ILLUM_PIN,  colorCalData.illumBrightness);
   analogWrite(ILLUM2_PIN, colorCalData.illumBrightness2);
+  if (!illumLit) {
+    illumLit       = true;
+    illumChangedAt = millis();
+  }
 }
 
 void illuminatorOff() {
   analogWrite(ILLUM_PIN,  0);
   analogWrite(ILLUM2_PIN, 0);
+  if (illumLit) {
+    illumLit       = false;
+    illumChangedAt = millis();
+  }
+}
+
+unsigned long illuminatorLastChangeMs() {
+  return illumChangedAt;
+}
+
+bool illuminatorIsOn() {
+  return illumLit;
 }
 
 void illuminatorSetBrightness(uint8_t brightness) {
+  if (brightness != colorCalData.illumBrightness) illumChangedAt = millis();
   colorCalData.illumBrightness = brightness;
   analogWrite(ILLUM_PIN, brightness);
 }
@@ -1132,6 +1156,7 @@ void colorCalSaveIlluminator() {
 // ============================================
 
 void illuminator2SetBrightness(uint8_t brightness) {
+  if (brightness != colorCalData.illumBrightness2) illumChangedAt = millis();
   colorCalData.illumBrightness2 = brightness;
   analogWrite(ILLUM2_PIN, brightness);
 }
@@ -661,6 +661,14 @@ uint16_t colorGetAstep();
 void illuminatorInit();
 void illuminatorOn();
 void illuminatorOff();
+/**
+ * millis() timestamp of the last real change in external illumination
+ * (on/off transition or a brightness change). Repeated illuminatorOn() calls
+ * while already lit do not move it. Used by the camera to skip whatever part
+ * of its light-settle window has already passed.
+ */
+unsigned long illuminatorLastChangeMs();
+bool illuminatorIsOn();   // external LEDs currently switched on
 void illuminatorSetBrightness(uint8_t brightness);
 uint8_t illuminatorGetBrightness();
 void colorCalSaveIlluminator();
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <EEPROM.h>
+#include "AnalogSampler.h"
 
 // ============================================
 // PIN CONFIGURATION
@@ -11,10 +12,7 @@
 // Analog pin connected to the pH sensor signal output
 #define PH_SENSOR_PIN A0
 
-// Optional: analog pin for DS18B20 / NTC thermistor temperature reading.
-// If you don't have a temperature sensor, the module falls back to 25 °C.
-// Set to -1 to disable.
-#define TEMP_SENSOR_PIN -1
+// Sample temperature comes from the DS18B20 in TempSensor.h (TEMP_ONEWIRE_PIN).
 
 // ============================================
 // CALIBRATION BUFFER SETTINGS
@@ -25,20 +23,40 @@
 #define CAL_PH_MID    6.86f   // pH 6.86 buffer
 #define CAL_PH_HIGH   9.18f   // pH 9.18 buffer
 
-// Number of ADC samples to average for a stable reading
-#define PH_SAMPLE_COUNT  10
+// A calibration uses 2..PH_CAL_MAX_POINTS buffers, captured in the order
+// given. The default is the classic 3-point set; adding e.g. 5.00 and 7.41
+// between them tightens the fit over the urine range (4.5-8). Change at run
+// time with calSetBuffers() or {"cmd":"cal","sensor":"ph","step":"begin",
+// "buffers":[4.0,6.86,9.18]}.
+#define PH_CAL_MIN_POINTS   2
+#define PH_CAL_MAX_POINTS   5
+#define PH_CAL_DEFAULT_BUFFERS  { CAL_PH_LOW, CAL_PH_MID, CAL_PH_HIGH }
+
+// pHReadVoltage() returns the boxcar mean of the newest PH_SYNC_CYCLES whole
+// mains cycles from the background sampler (AnalogSampler.h): 4 counts per
+// cycle, evenly spaced, so mains hum averages out exactly. One cycle (4
+// counts) replaces the old median of 10 arbitrarily spaced samples.
+#define PH_SYNC_CYCLES   1
+
+// Blocking fallback only (no free timer): Hampel-screened mean of
+// PH_SAMPLE_COUNT reads (RobustFilter::hampelMean).
+#define PH_SAMPLE_COUNT  7
 #define PH_SAMPLE_DELAY  10    // ms between samples
 
 // ============================================
 // EEPROM STORAGE
 // ============================================
 
-// EEPROM start address for calibration data.
-// Adjust if other modules also use EEPROM.
-#define PH_EEPROM_ADDR  0x00
-
-// Magic number written to EEPROM so we know calibration data is valid
-#define PH_EEPROM_MAGIC 0xA5
+// EEPROM start address for calibration data. The N-point record (44 B with
+// PH_CAL_MAX_POINTS = 5, including alignment padding) outgrew the original
+// 0x00..0x1F window, so it lives in the free gap after the BLE peer table,
+// which runs up to HISTORY_EEPROM_ADDR (both bounds are static_asserted).
+// 0x00 still holds the old fixed 3-point record, which calLoad() migrates
+// once if no N-point record exists yet.
+#define PH_EEPROM_ADDR         0xC8
+#define PH_EEPROM_MAGIC        0xA6
+#define PH_LEGACY_EEPROM_ADDR  0x00
+#define PH_LEGACY_EEPROM_MAGIC 0xA5
 
 // ============================================
 // TEMPERATURE COMPENSATION
@@ -57,22 +75,37 @@
 #define PH_ISOPOTENTIAL  7.00f
 
 // ============================================
-// CALIBRATION STABILITY CHECK
+// ENDPOINT DETECTION
 // ============================================
 //
-// During calCapture(), the probe is sampled over a window and the
-// capture is only accepted if the readings are stable enough.
-// Prevents capturing a calibration point while the probe is still
-// equilibrating, which is a common source of bad calibrations.
+// A glass electrode dropped into a fresh sample drifts for seconds. Like a
+// bench meter's auto-read, pHReadEndpoint() fits a least-squares slope (mV/s)
+// to the newest PH_ENDPOINT_WINDOW_MS of hum-free 100 ms block means from the
+// background sampler and declares the reading final as soon as |slope| drops
+// below PH_ENDPOINT_MAX_DRIFT_MV_S. Only blocks closed after the call count,
+// so even an electrode that is already stable waits one full window: history
+// from before the call (probe still in storage solution) can't be mistaken
+// for the sample. Both startTest() and calCapture() use it, each with its own
+// upper bound.
 //
-#define PH_CAL_STABILITY_WINDOW_MS    2000   // sample window length (ms)
-#define PH_CAL_STABILITY_SAMPLE_MS     100   // gap between samples in window
-#define PH_CAL_STABILITY_MAX_SPREAD   0.020f // max peak-to-peak (V) to accept
+#define PH_ENDPOINT_WINDOW_MS        1000   // slope fitted over this much history
+#define PH_ENDPOINT_MAX_DRIFT_MV_S   0.5f   // |drift| below this = endpoint
+#define PH_ENDPOINT_TEST_TIMEOUT_MS 15000   // test: read anyway (flagged WARN) after this
+#define PH_ENDPOINT_CAL_TIMEOUT_MS  10000   // calibration: reject capture after this
+#define PH_ENDPOINT_FALLBACK_STEP_MS  100   // reading spacing when no sampler timer
 
 // ============================================
 // DATA STRUCTURES
 // ============================================
 
+/** Result of an endpoint read (see ENDPOINT DETECTION above). */
+struct PHEndpoint {
+  float         voltage;       // mean over the final slope window (volts)
+  float         driftMvPerS;   // slope of that window (mV/s)
+  unsigned long elapsedMs;     // time from call to endpoint (or timeout)
+  bool          stable;        // false = timed out, reading still drifting
+};
+
 /**
  * Stores a single calibration point: the raw ADC voltage
  * measured while the probe was in a known-pH buffer.
@@ -83,14 +116,21 @@ struct CalibrationPoint {
 };
 
 /**
- * Complete 3-point calibration data.
- * Saved to and loaded from EEPROM.
+ * Complete N-point calibration data (2..PH_CAL_MAX_POINTS points, in
+ * capture order). Saved to and loaded from EEPROM.
  */
 struct pHCalibration {
-  uint8_t magic;             // validity marker
-  CalibrationPoint low;      // pH 4.00 point
-  CalibrationPoint mid;      // pH 6.86 point
-  CalibrationPoint high;     // pH 9.18 point
+  uint8_t magic;                               // validity marker
+  uint8_t count;                               // points in use
+  CalibrationPoint points[PH_CAL_MAX_POINTS];
+};
+
+/** The original fixed 3-point record at PH_LEGACY_EEPROM_ADDR (read-only). */
+struct pHCalibrationLegacy {
+  uint8_t magic;
+  CalibrationPoint low;
+  CalibrationPoint mid;
+  CalibrationPoint high;
 };
 
 // ============================================
@@ -103,22 +143,27 @@ struct pHCalibration {
  */
 enum CalibrationStep {
   CAL_IDLE = 0,
-  CAL_LOW,       // waiting for pH 4.00 reading
-  CAL_MID,       // waiting for pH 6.86 reading
-  CAL_HIGH,      // waiting for pH 9.18 reading
-  CAL_DONE       // all three points captured; ready to save
+  CAL_POINT,     // waiting for buffer calPointIndex
+  CAL_DONE       // every buffer captured; ready to save
 };
 
-extern CalibrationStep calStep;   // current calibration step
-extern pHCalibration   calData;   // working calibration data
+extern CalibrationStep calStep;         // current calibration step
+extern uint8_t         calPointIndex;   // buffer being captured (CAL_POINT)
+extern pHCalibration   calData;         // committed calibration (model source)
 
 // ============================================
 // INTERPOLATION MODE
 // ============================================
 
+// The calibration model is built ONCE from calData (on load, save or reset)
+// and cached: sorted knots, the per-knot slopes of a monotone piecewise-cubic
+// (PCHIP, Fritsch-Carlson) fit and the isopotential voltage. voltageToPH()
+// then costs one segment lookup and one cubic. PCHIP passes through every
+// point without the overshoot a single polynomial shows with 4-5 points, and
+// never turns back on itself between buffers.
 enum InterpolationMode {
-  INTERP_LAGRANGE,      // Quadratic through all 3 points (default, smoother)
-  INTERP_PIECEWISE      // Two straight-line segments (simpler)
+  INTERP_PCHIP,         // monotone piecewise cubic through all points (default)
+  INTERP_PIECEWISE      // straight-line segments between points (simpler)
 };
 
 // ============================================
@@ -126,8 +171,8 @@ enum InterpolationMode {
 // ============================================
 
 /**
- * Switch between Lagrange polynomial and piecewise linear interpolation.
- * Default on startup is INTERP_LAGRANGE.
+ * Switch between the PCHIP and piecewise linear models.
+ * Default on startup is INTERP_PCHIP.
  */
 void setInterpolationMode(InterpolationMode mode);
 
@@ -144,17 +189,29 @@ InterpolationMode getInterpolationMode();
 void pHSensorInit();
 
 /**
- * Read the raw ADC voltage from the pH probe (median-filtered).
+ * Read the raw ADC voltage from the pH probe.
  *
- * Uses a median filter rather than a mean: the high-impedance pH probe
- * picks up mains hum and the occasional ESD spike. A single outlier in
- * a small sample window can shift the mean by tens of millivolts; the
- * median rejects it cleanly. Same approach the TDS module uses.
+ * The high-impedance pH probe picks up mains hum. With the background
+ * sampler this is a boxcar mean over PH_SYNC_CYCLES whole mains cycles,
+ * which cancels the hum exactly; without it, a spike-screened mean of
+ * PH_SAMPLE_COUNT blocking reads. Same approach the TDS module uses.
  *
  * @return Voltage in volts (0–5 V or 0–3.3 V depending on board)
  */
 float pHReadVoltage();
 
+/**
+ * Wait for the electrode to stop drifting (see ENDPOINT DETECTION) and
+ * return the endpoint voltage, drift and time taken in `ep`. Gives up after
+ * timeoutMs with ep.stable = false and the latest window's values.
+ * `progress`, if given, is called once per window evaluation with |drift|
+ * in mV/s against PH_ENDPOINT_MAX_DRIFT_MV_S.
+ *
+ * @return ep.stable
+ */
+bool pHReadEndpoint(PHEndpoint& ep, unsigned long timeoutMs,
+                    SettleProgressFn progress = nullptr);
+
 /**
  * Convert a raw voltage to a pH value using the current calibration.
  *
@@ -162,10 +219,9 @@ float pHReadVoltage();
  *   1. Compensate the input voltage for sample temperature, pivoting
  *      around the probe's isopotential point (PH_ISOPOTENTIAL ≈ pH 7).
  *      This produces an equivalent voltage as if the sample were at 25 °C.
- *   2. Interpolate the compensated voltage through the 3 stored
- *      calibration points (Lagrange quadratic by default, falling back
- *      to piecewise linear outside the calibrated range to avoid the
- *      polynomial-edge-curl problem).
+ *   2. Evaluate the cached model at the compensated voltage (PCHIP by
+ *      default inside the calibrated range, linear extension of the end
+ *      segment outside it).
  *   3. Clamp to [0, 14].
  *
  * @param voltage     Raw probe voltage in volts
@@ -182,37 +238,45 @@ float voltageToPH(float voltage, float temperature = 25.0f);
 float pHRead(float temperature = 25.0f);
 
 /**
- * Read temperature from an attached sensor (if configured).
- * Returns 25.0 if TEMP_SENSOR_PIN == -1 or read fails.
+ * Newest sample temperature from TempSensor (never waits on a conversion).
+ * Returns TEMP_DEFAULT_C (25.0) if no probe is fitted or none has read yet.
  */
 float pHReadTemperature();
 
 // ---- Calibration helpers ----
 
 /**
- * Begin a new calibration sequence.
- * Resets the state machine to CAL_LOW.
+ * Begin a new calibration sequence over the current buffer list.
+ * Resets the state machine to the first buffer. The committed model keeps
+ * converting until calSave().
  */
 void calBegin();
 
+/**
+ * Set the buffer list for the next calibration: 2..PH_CAL_MAX_POINTS
+ * distinct pH values, captured in the given order.
+ * @return false (list unchanged) if the count or values are invalid.
+ */
+bool calSetBuffers(const float* pH, uint8_t count);
+
 /**
  * Capture the current probe reading for the active calibration step.
  *
- * Performs a stability check: samples the probe over
- * PH_CAL_STABILITY_WINDOW_MS and only accepts the capture if the
- * peak-to-peak spread is below PH_CAL_STABILITY_MAX_SPREAD volts.
- * If unstable, the function returns without advancing the state machine
- * and prints a warning — the user should wait longer for the probe to
- * equilibrate and try again.
+ * Waits for the endpoint (pHReadEndpoint()) for up to
+ * PH_ENDPOINT_CAL_TIMEOUT_MS and captures the endpoint voltage. If the
+ * electrode is still drifting at the timeout, the function returns without
+ * advancing the state machine and prints a warning — the user should wait
+ * longer for the probe to equilibrate and try again.
  *
- * Advances calStep on success.
+ * Advances calStep on success. `progress` is passed to pHReadEndpoint()
+ * so the calibration screen can show the drift while it waits.
  *
  * @return true if a stable reading was captured, false if rejected.
  */
-bool calCapture();
+bool calCapture(SettleProgressFn progress = nullptr);
 
 /**
- * Save the completed calibration to EEPROM.
+ * Commit the captured points, rebuild the model and save to EEPROM.
  * Should only be called when calStep == CAL_DONE.
  */
 void calSave();
@@ -223,15 +287,16 @@ void calSave();
 void calCancel();
 
 /**
- * Load calibration from EEPROM into calData.
- * @return true if valid data was found, false if defaults were applied.
+ * Load calibration from EEPROM into calData and rebuild the model. Falls
+ * back to (and re-saves) a legacy 3-point record at PH_LEGACY_EEPROM_ADDR.
+ * @return true if valid data was found, false if nothing usable was stored.
  */
 bool calLoad();
 
 /**
  * Reset calibration to built-in factory defaults and save to EEPROM.
- * Factory defaults assume a linear 0 V = pH 14, 3.3 V = pH 0 mapping
- * which will be inaccurate but safe to start from.
+ * Factory defaults are rough 3-point voltages for a typical 5 V analog
+ * module, which will be inaccurate but safe to start from.
  */
 void calResetToDefaults();
 
@@ -1,17 +1,23 @@
 #include "pHSensor.h"
+#include "AnalogSampler.h"
+#include "RobustFilter.h"
+#include "TempSensor.h"
 
 // ============================================
 // GLOBALS
 // ============================================
 
-CalibrationStep calStep = CAL_IDLE;
+CalibrationStep calStep       = CAL_IDLE;
+uint8_t         calPointIndex = 0;
 pHCalibration   calData;
 
-// ADC reference voltage for the board.
-// Arduino Uno / R4: 5.0 V
-// Arduino Nano 33 / MKR: 3.3 V  -- change if needed.
-static const float ADC_REF_VOLTAGE = 5.0f;
-static const float ADC_MAX         = 1023.0f;
+// Points being captured by the running calibration. Copied into calData only
+// on calSave(), so live conversions keep using the committed model meanwhile.
+static pHCalibration calWorking;
+
+// Buffers the next calBegin() walks through.
+static float   calBuffers[PH_CAL_MAX_POINTS] = PH_CAL_DEFAULT_BUFFERS;
+static uint8_t calBufferCount = 3;
 
 // ============================================
 // INITIALISATION
@@ -20,10 +26,6 @@ static const float ADC_MAX         = 1023.0f;
 void pHSensorInit() {
   pinMode(PH_SENSOR_PIN, INPUT);
 
-#if TEMP_SENSOR_PIN >= 0
-  pinMode(TEMP_SENSOR_PIN, INPUT);
-#endif
-
   if (!calLoad()) {
     Serial.println("[pH] No valid EEPROM calibration found — using defaults.");
     calResetToDefaults();   // saves defaults back to EEPROM
@@ -37,136 +39,208 @@ void pHSensorInit() {
 // READING
 // ============================================
 
-/**
- * Median-of-N helper. In-place insertion sort then return middle element.
- * For small N (PH_SAMPLE_COUNT = 10) insertion sort is faster than any
- * partial-sort cleverness and uses no heap.
- */
-static float medianOfPH(float* arr, int n) {
-  for (int i = 1; i < n; i++) {
-    float key = arr[i];
-    int j = i - 1;
-    while (j >= 0 && arr[j] > key) {
-      arr[j + 1] = arr[j];
-      j--;
-    }
-    arr[j + 1] = key;
+float pHReadVoltage() {
+  // Background sampler: boxcar mean of the newest PH_SYNC_CYCLES mains
+  // cycles, no ADC wait. Falls through to the blocking loop only if the
+  // timer never started.
+  float counts;
+  if (analogSamplerWaitBoxcar(ANALOG_CH_PH, PH_SYNC_CYCLES, counts)) {
+    return analogCountsToVolts(counts);
   }
-  if (n % 2 == 1) return arr[n / 2];
-  return (arr[n / 2 - 1] + arr[n / 2]) * 0.5f;
-}
 
-float pHReadVoltage() {
-  float samples[PH_SAMPLE_COUNT];
+  RobustFilter<PH_SAMPLE_COUNT> window;
   for (int i = 0; i < PH_SAMPLE_COUNT; i++) {
-    samples[i] = analogRead(PH_SENSOR_PIN) * (ADC_REF_VOLTAGE / ADC_MAX);
+    window.push(analogCountsToVolts(analogReadOversampled(PH_SENSOR_PIN)));
     delay(PH_SAMPLE_DELAY);
   }
-  return medianOfPH(samples, PH_SAMPLE_COUNT);
+  return window.hampelMean();
 }
 
 // Active interpolation mode (change via setInterpolationMode())
-static InterpolationMode interpMode = INTERP_LAGRANGE;
+static InterpolationMode interpMode = INTERP_PCHIP;
 
-void setInterpolationMode(InterpolationMode mode) {
-  interpMode = mode;
-  Serial.print("[pH] Interpolation mode set to: ");
-  Serial.println(mode == INTERP_LAGRANGE ? "Lagrange polynomial" : "Piecewise linear");
-}
+// ============================================
+// CALIBRATION MODEL (cached)
+// ============================================
 
-InterpolationMode getInterpolationMode() {
-  return interpMode;
-}
+// Built from calData by buildModel(); knots sorted by ascending voltage.
+struct PHModel {
+  bool    valid;
+  uint8_t n;
+  float   v[PH_CAL_MAX_POINTS];    // knot voltages (ascending)
+  float   p[PH_CAL_MAX_POINTS];    // pH at each knot
+  float   m[PH_CAL_MAX_POINTS];    // PCHIP slope dpH/dV at each knot
+  float   vIso;                    // voltage at PH_ISOPOTENTIAL (25 °C curve)
+};
 
-// ---- Internal helpers ----
+static PHModel model = { false, 0, {}, {}, {}, 0.0f };
+
+static float signOf(float x) { return (x > 0.0f) - (x < 0.0f); }
 
 /**
- * Piecewise-linear interpolation.
- * Splits the voltage range at the midpoint and fits a separate line
- * through each pair of adjacent calibration points.
+ * Fritsch-Carlson slopes. Interior knots take a weighted harmonic mean of the
+ * neighbouring secants (0 at a local extremum); the ends use the one-sided
+ * three-point estimate, clipped to keep the curve monotone. With two knots
+ * this degenerates to the straight line through them.
  */
-static float piecewiseLinear(float voltage,
-                              float vLow,  float pLow,
-                              float vMid,  float pMid,
-                              float vHigh, float pHigh) {
-  if (vMid == vLow && vHigh == vMid) return pMid;  // degenerate guard
-
-  if (voltage >= vMid) {
-    if (vHigh == vMid) return pMid;
-    float t = (voltage - vMid) / (vHigh - vMid);
-    return pMid + t * (pHigh - pMid);
-  } else {
-    if (vMid == vLow) return pLow;
-    float t = (voltage - vLow) / (vMid - vLow);
-    return pLow + t * (pMid - pLow);
+static void pchipSlopes(PHModel& md) {
+  const uint8_t n = md.n;
+  float h[PH_CAL_MAX_POINTS - 1], d[PH_CAL_MAX_POINTS - 1];
+  for (uint8_t k = 0; k + 1 < n; k++) {
+    h[k] = md.v[k + 1] - md.v[k];
+    d[k] = (md.p[k + 1] - md.p[k]) / h[k];
   }
+  if (n == 2) {
+    md.m[0] = md.m[1] = d[0];
+    return;
+  }
+
+  for (uint8_t k = 1; k + 1 < n; k++) {
+    if (d[k - 1] * d[k] <= 0.0f) {
+      md.m[k] = 0.0f;
+    } else {
+      float w1 = 2.0f * h[k] + h[k - 1];
+      float w2 = h[k] + 2.0f * h[k - 1];
+      md.m[k] = (w1 + w2) / (w1 / d[k - 1] + w2 / d[k]);
+    }
+  }
+
+  // End slopes: first knot from h[0], h[1]; last knot mirrored.
+  const uint8_t e = n - 2;   // index of the last secant
+  float m0 = ((2.0f * h[0] + h[1]) * d[0] - h[0] * d[1]) / (h[0] + h[1]);
+  if (signOf(m0) != signOf(d[0])) {
+    m0 = 0.0f;
+  } else if (signOf(d[0]) != signOf(d[1]) && fabsf(m0) > 3.0f * fabsf(d[0])) {
+    m0 = 3.0f * d[0];
+  }
+  md.m[0] = m0;
+
+  float mn = ((2.0f * h[e] + h[e - 1]) * d[e] - h[e] * d[e - 1]) / (h[e] + h[e - 1]);
+  if (signOf(mn) != signOf(d[e])) {
+    mn = 0.0f;
+  } else if (signOf(d[e]) != signOf(d[e - 1]) && fabsf(mn) > 3.0f * fabsf(d[e])) {
+    mn = 3.0f * d[e];
+  }
+  md.m[n - 1] = mn;
 }
 
 /**
- * Lagrange quadratic interpolation through all three calibration points.
- *
- * Fits a single smooth quadratic curve that passes exactly through every
- * calibration point — no kink at the midpoint like piecewise linear has.
- *
- *   pH = pLow  * (V-vMid)(V-vHigh) / (vLow-vMid)(vLow-vHigh)
- *      + pMid  * (V-vLow)(V-vHigh) / (vMid-vLow)(vMid-vHigh)
- *      + pHigh * (V-vLow)(V-vMid)  / (vHigh-vLow)(vHigh-vMid)
+ * pH at an (already temperature-compensated) voltage. Inside the knots: the
+ * cubic Hermite segment (or the chord, in INTERP_PIECEWISE). Outside: the
+ * straight line of the end segment — extrapolating a cubic curls badly.
  */
-static float lagrangePolynomial(float voltage,
-                                 float vLow,  float pLow,
-                                 float vMid,  float pMid,
-                                 float vHigh, float pHigh) {
-  float d0 = (vLow  - vMid) * (vLow  - vHigh);
-  float d1 = (vMid  - vLow) * (vMid  - vHigh);
-  float d2 = (vHigh - vLow) * (vHigh - vMid);
-
-  // Guard against degenerate calibration (two identical voltages)
-  if (fabsf(d0) < 1e-6f || fabsf(d1) < 1e-6f || fabsf(d2) < 1e-6f) {
-    // Fall back to piecewise linear if points are too close
-    return piecewiseLinear(voltage, vLow, pLow, vMid, pMid, vHigh, pHigh);
+static float evalModel(float v) {
+  const PHModel& md = model;
+  const uint8_t last = md.n - 1;
+
+  uint8_t k;
+  if (v <= md.v[0])         k = 0;
+  else if (v >= md.v[last]) k = last - 1;
+  else {
+    k = 0;
+    while (k + 1 < last && v > md.v[k + 1]) k++;
   }
 
-  float L0 = pLow  * ((voltage - vMid)  * (voltage - vHigh)) / d0;
-  float L1 = pMid  * ((voltage - vLow)  * (voltage - vHigh)) / d1;
-  float L2 = pHigh * ((voltage - vLow)  * (voltage - vMid))  / d2;
+  float h  = md.v[k + 1] - md.v[k];
+  float dk = (md.p[k + 1] - md.p[k]) / h;
+  if (v < md.v[0] || v > md.v[last] || interpMode == INTERP_PIECEWISE) {
+    return md.p[k] + dk * (v - md.v[k]);
+  }
 
-  return L0 + L1 + L2;
+  float t  = (v - md.v[k]) / h;
+  float t2 = t * t, t3 = t2 * t;
+  return (2.0f * t3 - 3.0f * t2 + 1.0f) * md.p[k]
+       + (t3 - 2.0f * t2 + t)         * h * md.m[k]
+       + (-2.0f * t3 + 3.0f * t2)     * md.p[k + 1]
+       + (t3 - t2)                    * h * md.m[k + 1];
 }
 
-// ---- Public conversion function ----
+/**
+ * Voltage at which the (monotone) model reads PH_ISOPOTENTIAL. Bisection
+ * inside the knots, the end-segment line outside them. Done once per build.
+ */
+static float solveIsoVoltage() {
+  const PHModel& md = model;
+  const uint8_t last = md.n - 1;
+  float pLo = evalModel(md.v[0]);
+  float pHi = evalModel(md.v[last]);
+  float target = PH_ISOPOTENTIAL;
+
+  bool inside = (target - pLo) * (target - pHi) <= 0.0f;
+  if (!inside) {
+    // Invert the end line nearest the target.
+    uint8_t k = (fabsf(target - pLo) < fabsf(target - pHi)) ? 0 : last - 1;
+    float slope = (md.p[k + 1] - md.p[k]) / (md.v[k + 1] - md.v[k]);
+    return md.v[k] + (target - md.p[k]) / slope;
+  }
+
+  float a = md.v[0], b = md.v[last];
+  float fa = pLo - target;
+  for (uint8_t i = 0; i < 32; i++) {
+    float mid = 0.5f * (a + b);
+    float fm  = evalModel(mid) - target;
+    if (fa * fm <= 0.0f) { b = mid; }
+    else                 { a = mid; fa = fm; }
+  }
+  return 0.5f * (a + b);
+}
 
 /**
- * Find the calibration voltage corresponding to the isopotential pH (~7.00).
- *
- * The probe's isopotential point is where output voltage is independent
- * of temperature. We don't directly measure it; we estimate it from the
- * three calibration points by interpolating the voltage at PH_ISOPOTENTIAL
- * using the same Lagrange polynomial we use for pH lookup, but in reverse
- * (pH → voltage rather than voltage → pH).
- *
- * This is computed once per call to voltageToPH() rather than cached so
- * that re-calibration takes effect immediately without a separate refresh.
+ * Rebuild the cached model from calData. Called on every load, save and reset,
+ * so a recalibration replaces the model the moment it is committed. A record
+ * with fewer than two distinct voltages leaves the model invalid, and
+ * voltageToPH() then returns neutral pH.
  */
-static float computeIsoVoltage() {
-  // Lagrange interpolation in (pH, voltage) space at point pH = ISO
-  float pL = calData.low.pH,  vL = calData.low.voltage;
-  float pM = calData.mid.pH,  vM = calData.mid.voltage;
-  float pH_ = calData.high.pH, vH = calData.high.voltage;
-  float P  = PH_ISOPOTENTIAL;
-
-  float d0 = (pL - pM) * (pL - pH_);
-  float d1 = (pM - pL) * (pM - pH_);
-  float d2 = (pH_ - pL) * (pH_ - pM);
-
-  if (fabsf(d0) < 1e-6f || fabsf(d1) < 1e-6f || fabsf(d2) < 1e-6f) {
-    return vM;   // safe fallback: assume iso voltage ≈ mid-buffer voltage
+static void buildModel() {
+  PHModel md = { false, 0, {}, {}, {}, 0.0f };
+  uint8_t n = calData.count;
+  if (n > PH_CAL_MAX_POINTS) n = PH_CAL_MAX_POINTS;
+
+  // Insertion sort by voltage (n <= 5).
+  for (uint8_t i = 0; i < n; i++) {
+    float v = calData.points[i].voltage, p = calData.points[i].pH;
+    int8_t j = (int8_t)md.n - 1;
+    while (j >= 0 && md.v[j] > v) {
+      md.v[j + 1] = md.v[j];
+      md.p[j + 1] = md.p[j];
+      j--;
+    }
+    md.v[j + 1] = v;
+    md.p[j + 1] = p;
+    md.n++;
+  }
+
+  for (uint8_t k = 0; k + 1 < md.n; k++) {
+    if (md.v[k + 1] - md.v[k] < 1e-4f) {
+      Serial.println("[pH] Model: two points share a voltage — calibration unusable.");
+      model = md;
+      return;
+    }
   }
+  if (md.n < PH_CAL_MIN_POINTS) {
+    model = md;
+    return;
+  }
+
+  pchipSlopes(md);
+  md.valid = true;
+  model = md;
+  model.vIso = solveIsoVoltage();
+}
+
+void setInterpolationMode(InterpolationMode mode) {
+  interpMode = mode;
+  if (model.valid) model.vIso = solveIsoVoltage();
+  Serial.print("[pH] Interpolation mode set to: ");
+  Serial.println(mode == INTERP_PCHIP ? "PCHIP (monotone cubic)" : "Piecewise linear");
+}
 
-  return vL  * ((P - pM) * (P - pH_)) / d0
-       + vM  * ((P - pL) * (P - pH_)) / d1
-       + vH  * ((P - pL) * (P - pM))  / d2;
+InterpolationMode getInterpolationMode() {
+  return interpMode;
 }
 
+// ---- Public conversion function ----
+
 /**
  * Convert a raw probe voltage to pH.
  *
@@ -174,81 +248,129 @@ static float computeIsoVoltage() {
  *         isopotential point. The Nernst slope scales as T_K/298.15, so a
  *         given voltage deviation from V_iso corresponds to a smaller pH
  *         deviation at higher T. We rescale the voltage so the subsequent
- *         interpolation (which encodes the 25 °C-equivalent calibration
- *         curve) sees the "as if at 25 °C" voltage.
+ *         lookup (which encodes the 25 °C-equivalent calibration curve)
+ *         sees the "as if at 25 °C" voltage.
  *
  *           V_25 = V_iso + (V - V_iso) / (T_K / 298.15)
  *
- *         Note: this relies on the calibration having been performed at
- *         (or near) 25 °C, which is the assumption every pH module datasheet
- *         makes for its three-point calibration procedure.
+ *         V_iso comes from the cached model. This relies on the calibration
+ *         having been performed at (or near) 25 °C, which is the assumption
+ *         every pH module datasheet makes for its calibration procedure.
  *
- * Step 2: Interpolate. Lagrange quadratic inside the calibrated range,
- *         linear extension outside (Lagrange extrapolation curls badly).
+ * Step 2: Evaluate the cached model (see evalModel()).
  *
  * Step 3: Clamp to [0, 14].
  */
 float voltageToPH(float voltage, float temperature) {
+  if (!model.valid) return PH_ISOPOTENTIAL;
+
   // ---- Step 1: temperature compensation in voltage space ----
   float tempKelvin = temperature + 273.15f;
   float tempFactor = tempKelvin / 298.15f;     // 1.0 at 25 °C
   if (tempFactor < 0.5f) tempFactor = 0.5f;    // sanity floor (-136 °C!)
 
-  float vIso     = computeIsoVoltage();
-  float voltage25 = vIso + (voltage - vIso) / tempFactor;
-
-  // ---- Step 2: interpolation ----
-  float vLow  = calData.low.voltage;
-  float vMid  = calData.mid.voltage;
-  float vHigh = calData.high.voltage;
-  float pLow  = calData.low.pH;
-  float pMid  = calData.mid.pH;
-  float pHigh = calData.high.pH;
-
-  // For typical glass probes voltage DECREASES as pH rises, so the
-  // calibration order in voltage space is vLow > vMid > vHigh. Determine
-  // the inside/outside region by comparing against the extreme cal voltages.
-  float vMin = fminf(vLow, vHigh);
-  float vMax = fmaxf(vLow, vHigh);
-
-  float pH;
-
-  if (voltage25 >= vMin && voltage25 <= vMax) {
-    // Inside calibrated range — use chosen interpolation mode.
-    if (interpMode == INTERP_LAGRANGE) {
-      pH = lagrangePolynomial(voltage25, vLow, pLow, vMid, pMid, vHigh, pHigh);
+  float voltage25 = model.vIso + (voltage - model.vIso) / tempFactor;
+
+  // ---- Step 2: model lookup ----
+  float pH = evalModel(voltage25);
+
+  // ---- Step 3: clamp ----
+  return constrain(pH, 0.0f, 14.0f);
+}
+
+// ============================================
+// ENDPOINT DETECTION
+// ============================================
+
+/** Least-squares slope of y[0..n-1] against time, samples dt seconds apart. */
+static float slopePerSecond(const float* y, uint8_t n, float dt) {
+  float xMean = (n - 1) * 0.5f;
+  float yMean = 0.0f;
+  for (uint8_t i = 0; i < n; i++) yMean += y[i];
+  yMean /= n;
+
+  float num = 0.0f, den = 0.0f;
+  for (uint8_t i = 0; i < n; i++) {
+    float dx = i - xMean;
+    num += dx * (y[i] - yMean);
+    den += dx * dx;
+  }
+  return (den > 0.0f) ? num / den / dt : 0.0f;
+}
+
+bool pHReadEndpoint(PHEndpoint& ep, unsigned long timeoutMs,
+                    SettleProgressFn progress) {
+  const unsigned long t0 = millis();
+  float buf[ANALOG_STAB_BLOCKS];
+  uint8_t have = 0;
+
+  // The block ring already holds history from before this call (probe still
+  // in storage solution, or in the air). Only blocks closed after entry may
+  // count towards the window.
+  const uint32_t seq0 = analogSamplerBlockSeq(ANALOG_CH_PH);
+
+  ep.voltage     = 0.0f;
+  ep.driftMvPerS = 0.0f;
+  ep.stable      = false;
+
+  while (true) {
+    // Window: the sampler's block means when it runs, else our own readings
+    // PH_ENDPOINT_FALLBACK_STEP_MS apart, shifted through the same buffer.
+    bool  sampled = analogSamplerRunning();
+    float dt = sampled ? analogSamplerBlockSeconds()
+                       : PH_ENDPOINT_FALLBACK_STEP_MS / 1000.0f;
+    uint8_t n = (uint8_t)constrain((int)(PH_ENDPOINT_WINDOW_MS / 1000.0f / dt + 0.5f),
+                                   3, ANALOG_STAB_BLOCKS);
+    if (sampled) {
+      uint32_t fresh = analogSamplerBlockSeq(ANALOG_CH_PH) - seq0;
+      have = analogSamplerBlocks(ANALOG_CH_PH, buf, n);
+      if (fresh < have) have = (uint8_t)fresh;
     } else {
-      pH = piecewiseLinear(voltage25, vLow, pLow, vMid, pMid, vHigh, pHigh);
-    }
-  } else {
-    // Outside calibrated range — linear extension of the nearest segment.
-    // Lagrange extrapolation curls aggressively and can even go non-
-    // monotonic, so we never use it past the cal points.
-    if (vLow > vHigh) {
-      // Standard probe orientation: high V = low pH
-      if (voltage25 > vLow) {
-        // Below pH_LOW — extend the low/mid line
-        float slope = (pMid - pLow) / (vMid - vLow);
-        pH = pLow + slope * (voltage25 - vLow);
-      } else {
-        // Above pH_HIGH — extend the mid/high line
-        float slope = (pHigh - pMid) / (vHigh - vMid);
-        pH = pHigh + slope * (voltage25 - vHigh);
+      if (have == n) {
+        memmove(buf, buf + 1, (n - 1) * sizeof(float));
+        have--;
       }
-    } else {
-      // Inverted orientation (rare, but support it). Mirror logic.
-      if (voltage25 < vLow) {
-        float slope = (pMid - pLow) / (vMid - vLow);
-        pH = pLow + slope * (voltage25 - vLow);
-      } else {
-        float slope = (pHigh - pMid) / (vHigh - vMid);
-        pH = pHigh + slope * (voltage25 - vHigh);
+      buf[have++] = pHReadVoltage();
+    }
+
+    if (have >= n) {
+      float mean = 0.0f;
+      for (uint8_t i = 0; i < n; i++) mean += buf[i];
+      mean /= n;
+      ep.voltage     = sampled ? analogCountsToVolts(mean) : mean;
+      float slope    = slopePerSecond(buf, n, dt);
+      ep.driftMvPerS = (sampled ? analogCountsToVolts(slope) : slope) * 1000.0f;
+      if (fabsf(ep.driftMvPerS) < PH_ENDPOINT_MAX_DRIFT_MV_S) {
+        ep.stable = true;
+        break;
       }
     }
+
+    if (progress) {
+      SettleProgress p = { have >= n ? fabsf(ep.driftMvPerS) : -1.0f,
+                           PH_ENDPOINT_MAX_DRIFT_MV_S, millis() - t0, timeoutMs };
+      progress(p);
+    }
+
+    if (millis() - t0 >= timeoutMs) {
+      if (have < n) ep.voltage = pHReadVoltage();
+      break;
+    }
+    delay(sampled ? (unsigned long)(dt * 1000.0f) : PH_ENDPOINT_FALLBACK_STEP_MS);
   }
 
-  // ---- Step 3: clamp ----
-  return constrain(pH, 0.0f, 14.0f);
+  ep.elapsedMs = millis() - t0;
+
+  Serial.print("[pH] Endpoint ");
+  Serial.print(ep.stable ? "reached" : "TIMEOUT");
+  Serial.print(" after ");
+  Serial.print(ep.elapsedMs);
+  Serial.print(" ms: ");
+  Serial.print(ep.voltage, 4);
+  Serial.print(" V, drift ");
+  Serial.print(ep.driftMvPerS, 2);
+  Serial.println(" mV/s");
+  return ep.stable;
 }
 
 float pHRead(float temperature) {
@@ -257,17 +379,10 @@ float pHRead(float temperature) {
 }
 
 float pHReadTemperature() {
-#if TEMP_SENSOR_PIN >= 0
-  // Basic NTC / analogue thermistor read.
-  // Replace with your actual temperature sensor library call if needed.
-  int raw = analogRead(TEMP_SENSOR_PIN);
-  // Placeholder linear conversion — update for your thermistor's curve.
-  float voltage = raw * (ADC_REF_VOLTAGE / ADC_MAX);
-  float tempC   = (voltage - 0.5f) * 100.0f;   // e.g. LM35-style
-  return tempC;
-#else
-  return 25.0f;   // assume room temperature if no sensor fitted
-#endif
+  // Collects a finished background conversion if there is one; otherwise
+  // this is just the cached value.
+  tempSensorService();
+  return tempLatestC();
 }
 
 // ============================================
@@ -275,43 +390,31 @@ float pHReadTemperature() {
 // ============================================
 
 void calBegin() {
-  calStep = CAL_LOW;
-  Serial.println("[pH] Calibration started. Place probe in pH 4.00 buffer.");
+  calWorking.count = 0;
+  calPointIndex    = 0;
+  calStep          = CAL_POINT;
+  Serial.print("[pH] Calibration started (");
+  Serial.print(calBufferCount);
+  Serial.print(" points). Place probe in pH ");
+  Serial.print(calBuffers[0], 2);
+  Serial.println(" buffer.");
 }
 
-/**
- * Sample the probe over PH_CAL_STABILITY_WINDOW_MS and report:
- *   - the median voltage across the window
- *   - the peak-to-peak spread (max - min) across the window
- *
- * If the spread is large, the probe hasn't equilibrated yet and the
- * caller should refuse to capture.
- */
-static void measureStability(float& median, float& spread) {
-  const int N = PH_CAL_STABILITY_WINDOW_MS / PH_CAL_STABILITY_SAMPLE_MS;
-  // N is at most ~20 for the default 2 s / 100 ms settings — fine on stack.
-  float buf[N];
-  for (int i = 0; i < N; i++) {
-    // Each sample is itself a median of PH_SAMPLE_COUNT raw reads, so
-    // we get robust filtering at two levels: in-sample noise rejection
-    // here, and across-sample equilibration detection in the caller.
-    buf[i] = pHReadVoltage();
-    if (i < N - 1) delay(PH_CAL_STABILITY_SAMPLE_MS);
-  }
-
-  // Min / max across the window
-  float vMin = buf[0], vMax = buf[0];
-  for (int i = 1; i < N; i++) {
-    if (buf[i] < vMin) vMin = buf[i];
-    if (buf[i] > vMax) vMax = buf[i];
+bool calSetBuffers(const float* pH, uint8_t count) {
+  if (count < PH_CAL_MIN_POINTS || count > PH_CAL_MAX_POINTS) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    if (pH[i] < 0.0f || pH[i] > 14.0f) return false;
+    for (uint8_t j = 0; j < i; j++) {
+      if (fabsf(pH[i] - pH[j]) < 0.1f) return false;
+    }
   }
-  spread = vMax - vMin;
-
-  median = medianOfPH(buf, N);
+  memcpy(calBuffers, pH, count * sizeof(float));
+  calBufferCount = count;
+  return true;
 }
 
-bool calCapture() {
-  if (calStep != CAL_LOW && calStep != CAL_MID && calStep != CAL_HIGH) {
+bool calCapture(SettleProgressFn progress) {
+  if (calStep != CAL_POINT) {
     if (calStep == CAL_DONE) {
       Serial.println("[pH] Already done — call calSave() or calBegin() to restart.");
     } else {
@@ -320,51 +423,33 @@ bool calCapture() {
     return false;
   }
 
-  float v, spread;
-  measureStability(v, spread);
-
-  Serial.print("[pH] Stability: spread = ");
-  Serial.print(spread * 1000.0f, 1);
-  Serial.println(" mV over window.");
-
-  if (spread > PH_CAL_STABILITY_MAX_SPREAD) {
-    Serial.print("[pH] REJECTED: probe not stable (need <");
-    Serial.print(PH_CAL_STABILITY_MAX_SPREAD * 1000.0f, 0);
-    Serial.println(" mV). Wait for equilibration and retry.");
+  PHEndpoint ep;
+  if (!pHReadEndpoint(ep, PH_ENDPOINT_CAL_TIMEOUT_MS, progress)) {
+    Serial.print("[pH] REJECTED: probe still drifting (need <");
+    Serial.print(PH_ENDPOINT_MAX_DRIFT_MV_S, 1);
+    Serial.println(" mV/s). Wait for equilibration and retry.");
     return false;
   }
 
-  switch (calStep) {
-    case CAL_LOW:
-      calData.low.voltage = v;
-      calData.low.pH      = CAL_PH_LOW;
-      Serial.print("[pH] pH 4.00 captured. Voltage = ");
-      Serial.println(v, 4);
-      Serial.println("[pH] Place probe in pH 6.86 buffer.");
-      calStep = CAL_MID;
-      return true;
-
-    case CAL_MID:
-      calData.mid.voltage = v;
-      calData.mid.pH      = CAL_PH_MID;
-      Serial.print("[pH] pH 6.86 captured. Voltage = ");
-      Serial.println(v, 4);
-      Serial.println("[pH] Place probe in pH 9.18 buffer.");
-      calStep = CAL_HIGH;
-      return true;
-
-    case CAL_HIGH:
-      calData.high.voltage = v;
-      calData.high.pH      = CAL_PH_HIGH;
-      Serial.print("[pH] pH 9.18 captured. Voltage = ");
-      Serial.println(v, 4);
-      Serial.println("[pH] All points captured. Call calSave() to store.");
-      calStep = CAL_DONE;
-      return true;
-
-    default:
-      return false;   // unreachable, silences warning
+  CalibrationPoint& pt = calWorking.points[calPointIndex];
+  pt.voltage = ep.voltage;
+  pt.pH      = calBuffers[calPointIndex];
+  calWorking.count = ++calPointIndex;
+
+  Serial.print("[pH] pH ");
+  Serial.print(pt.pH, 2);
+  Serial.print(" captured. Voltage = ");
+  Serial.println(pt.voltage, 4);
+
+  if (calPointIndex < calBufferCount) {
+    Serial.print("[pH] Place probe in pH ");
+    Serial.print(calBuffers[calPointIndex], 2);
+    Serial.println(" buffer.");
+  } else {
+    Serial.println("[pH] All points captured. Call calSave() to store.");
+    calStep = CAL_DONE;
   }
+  return true;
 }
 
 void calSave() {
@@ -373,8 +458,10 @@ void calSave() {
     return;
   }
 
-  calData.magic = PH_EEPROM_MAGIC;
+  calWorking.magic = PH_EEPROM_MAGIC;
+  calData = calWorking;
   EEPROM.put(PH_EEPROM_ADDR, calData);
+  buildModel();
   calStep = CAL_IDLE;
 
   Serial.println("[pH] Calibration saved to EEPROM.");
@@ -389,9 +476,26 @@ void calCancel() {
 
 bool calLoad() {
   EEPROM.get(PH_EEPROM_ADDR, calData);
-  if (calData.magic != PH_EEPROM_MAGIC) {
+  if (calData.magic == PH_EEPROM_MAGIC &&
+      calData.count >= PH_CAL_MIN_POINTS && calData.count <= PH_CAL_MAX_POINTS) {
+    buildModel();
+    return true;
+  }
+
+  // One-time migration of the original fixed 3-point record.
+  pHCalibrationLegacy legacy;
+  EEPROM.get(PH_LEGACY_EEPROM_ADDR, legacy);
+  if (legacy.magic != PH_LEGACY_EEPROM_MAGIC) {
     return false;
   }
+  calData.magic     = PH_EEPROM_MAGIC;
+  calData.count     = 3;
+  calData.points[0] = legacy.low;
+  calData.points[1] = legacy.mid;
+  calData.points[2] = legacy.high;
+  EEPROM.put(PH_EEPROM_ADDR, calData);
+  buildModel();
+  Serial.println("[pH] Migrated 3-point calibration to the N-point record.");
   return true;
 }
 
@@ -399,39 +503,47 @@ void calResetToDefaults() {
   // These default voltages are rough estimates for a typical pH analog module
   // powered at 5 V with a linear output. They will give usable readings but
   // a proper calibration with real buffers is strongly recommended.
-  calData.magic          = PH_EEPROM_MAGIC;
+  calData.magic  = PH_EEPROM_MAGIC;
+  calData.count  = 3;
 
-  calData.low.pH         = CAL_PH_LOW;    // 4.00
-  calData.low.voltage    = 3.05f;         // approx for most analog pH modules
+  calData.points[0].pH      = CAL_PH_LOW;    // 4.00
+  calData.points[0].voltage = 3.05f;         // approx for most analog pH modules
 
-  calData.mid.pH         = CAL_PH_MID;   // 6.86
-  calData.mid.voltage    = 2.50f;
+  calData.points[1].pH      = CAL_PH_MID;    // 6.86
+  calData.points[1].voltage = 2.50f;
 
-  calData.high.pH        = CAL_PH_HIGH;  // 9.18
-  calData.high.voltage   = 2.00f;
+  calData.points[2].pH      = CAL_PH_HIGH;   // 9.18
+  calData.points[2].voltage = 2.00f;
 
   EEPROM.put(PH_EEPROM_ADDR, calData);
+  buildModel();
   Serial.println("[pH] Default calibration applied and saved to EEPROM.");
 }
 
 const char* calStepLabel() {
+  static char label[24];
   switch (calStep) {
-    case CAL_IDLE: return "Idle";
-    case CAL_LOW:  return "Put probe in pH 4.00";
-    case CAL_MID:  return "Put probe in pH 6.86";
-    case CAL_HIGH: return "Put probe in pH 9.18";
-    case CAL_DONE: return "Press SELECT to save";
-    default:       return "Unknown";
+    case CAL_IDLE:  return "Idle";
+    case CAL_POINT:
+      snprintf(label, sizeof(label), "Put probe in pH %.2f", calBuffers[calPointIndex]);
+      return label;
+    case CAL_DONE:  return "Press SELECT to save";
+    default:        return "Unknown";
   }
 }
 
 void calPrint() {
   Serial.println("[pH] --- Calibration Data ---");
-  Serial.print("  Low  | pH ");  Serial.print(calData.low.pH,  2);
-  Serial.print(" @ "); Serial.print(calData.low.voltage,  4); Serial.println(" V");
-  Serial.print("  Mid  | pH ");  Serial.print(calData.mid.pH,  2);
-  Serial.print(" @ "); Serial.print(calData.mid.voltage,  4); Serial.println(" V");
-  Serial.print("  High | pH ");  Serial.print(calData.high.pH, 2);
-  Serial.print(" @ "); Serial.print(calData.high.voltage, 4); Serial.println(" V");
+  for (uint8_t i = 0; i < calData.count && i < PH_CAL_MAX_POINTS; i++) {
+    Serial.print("  #"); Serial.print(i + 1);
+    Serial.print(" | pH "); Serial.print(calData.points[i].pH, 2);
+    Serial.print(" @ "); Serial.print(calData.points[i].voltage, 4); Serial.println(" V");
+  }
+  if (model.valid) {
+    Serial.print("  Iso  | pH "); Serial.print(PH_ISOPOTENTIAL, 2);
+    Serial.print(" @ "); Serial.print(model.vIso, 4); Serial.println(" V");
+  } else {
+    Serial.println("  Model INVALID (need 2+ distinct voltages)");
+  }
   Serial.println("[pH] ----------------------------");
-}
\ No newline at end of file
+}
@@ -1,4 +1,6 @@
 #include "tdsSensor.h"
+#include "AnalogSampler.h"
+#include "RobustFilter.h"
 
 // ============================================
 // GLOBALS
@@ -7,18 +9,12 @@
 TDSCalStep     tdsCalStep = TDS_CAL_IDLE;
 TDSCalibration tdsCalData;
 
-// ADC reference voltage / resolution for the board.
-// MUST match every other analog module (pHSensor uses the same): the sketch
-// never calls analogReadResolution(), so the ADC is 10-bit (1023) at 5.0 V.
-// Changing either here would silently corrupt pH and temperature readings too.
-static const float ADC_REF_VOLTAGE = 5.0f;
-static const float ADC_MAX         = 1023.0f;
-
 // Tracks whether the high-side power gate is currently energised. Lets
 // tdsReadVoltage() decide between "just sample" (probe already on, e.g. the
 // calibration screen or the test sequence pinned it) and a self-contained
 // on -> settle -> read -> off cycle for one-shot reads.
 static bool tdsPowered = false;
+static unsigned long tdsPoweredAt = 0;   // millis() of the last OFF->ON edge
 
 // Inactive drive level for the power-gate pin (logical opposite of active).
 #define TDS_POWER_INACTIVE_LEVEL  ((TDS_POWER_ACTIVE_LEVEL) == HIGH ? LOW : HIGH)
@@ -50,17 +46,24 @@ void tdsSensorInit() {
 
 void tdsPowerOn() {
   digitalWrite(TDS_POWER_PIN, TDS_POWER_ACTIVE_LEVEL);
+  // Re-arm only on an OFF->ON edge: callers that pin the probe on and then
+  // call tdsPowerOn() again must not lose the settled history.
+  if (!tdsPowered) {
+    analogSamplerArm(ANALOG_CH_TDS);
+    tdsPoweredAt = millis();
+  }
   tdsPowered = true;
 }
 
 void tdsPowerOff() {
   digitalWrite(TDS_POWER_PIN, TDS_POWER_INACTIVE_LEVEL);
+  analogSamplerDisarm(ANALOG_CH_TDS);
   tdsPowered = false;
 }
 
 void tdsPowerOnAndSettle() {
   tdsPowerOn();
-  delay(TDS_POWER_SETTLE_MS);
+  tdsSettleAndRead();
 }
 
 bool tdsIsPowered() {
@@ -71,47 +74,143 @@ bool tdsIsPowered() {
 // READING
 // ============================================
 
-/**
- * Median-of-N helper. In-place insertion sort then return the middle element.
- * For small N insertion sort beats anything fancier and uses no heap. A median
- * rejects mains hum and the odd ADC/ESD spike far better than a mean.
- * (Identical approach to the pH module.)
- */
-static float medianOfTDS(float* arr, int n) {
-  for (int i = 1; i < n; i++) {
-    float key = arr[i];
-    int j = i - 1;
-    while (j >= 0 && arr[j] > key) {
-      arr[j + 1] = arr[j];
-      j--;
-    }
-    arr[j + 1] = key;
-  }
-  if (n % 2 == 1) return arr[n / 2];
-  return (arr[n / 2 - 1] + arr[n / 2]) * 0.5f;
-}
-
 float tdsReadVoltage() {
   // Auto power management. If the probe is already powered (calibration screen
   // or test sequence pinned it ON) we just sample — no toggling, no settle
   // delay, no MOSFET thrash. If it is OFF, run a self-contained power cycle so
-  // a one-shot read "just works" without external power management.
-  bool selfPower = !tdsPowered;
-  if (selfPower) {
-    tdsPowerOnAndSettle();
+  // a one-shot read "just works" without external power management. The
+  // settle already ends on a (possibly extrapolated) reading, so that is the
+  // answer; sampling again would throw the prediction away.
+  if (!tdsPowered) {
+    float v = tdsSettleAndRead();
+    tdsPowerOff();
+    return v;
   }
 
-  float samples[TDS_SAMPLE_COUNT];
+  // Background sampler: the TDS ring only ever holds counts taken while the
+  // probe was powered, and only the newest 8 mains cycles of them, so after
+  // the settle window it is entirely settled data.
+  float counts;
+  if (analogSamplerWaitBoxcar(ANALOG_CH_TDS, TDS_SYNC_CYCLES, counts)) {
+    return analogCountsToVolts(counts);
+  }
+
+  // Blocking fallback: drop the odd ADC/ESD spike (Hampel), then average the
+  // rest, which a plain mean can't survive and a median is noisier than.
+  RobustFilter<TDS_SAMPLE_COUNT> window;
   for (int i = 0; i < TDS_SAMPLE_COUNT; i++) {
-    samples[i] = analogRead(TDS_SENSOR_PIN) * (ADC_REF_VOLTAGE / ADC_MAX);
+    window.push(analogCountsToVolts(analogReadOversampled(TDS_SENSOR_PIN)));
     delay(TDS_SAMPLE_DELAY);
   }
-  float v = medianOfTDS(samples, TDS_SAMPLE_COUNT);
+  return window.hampelMean();
+}
 
-  if (selfPower) {
-    tdsPowerOff();
+// ============================================
+// PREDICTIVE SETTLE
+// ============================================
+
+/** Wait until `at` (millis), servicing nothing — callers own the BLE poll. */
+static void waitUntil(unsigned long at) {
+  long remaining = (long)(at - millis());
+  if (remaining > 0) delay((unsigned long)remaining);
+}
+
+/**
+ * Asymptote of a first-order step through three equally spaced readings.
+ * False if the triple is not a monotone decaying approach (noise, overshoot)
+ * or is too flat to fit, in which case the caller just keeps sampling.
+ */
+static bool fitAsymptote(float v0, float v1, float v2, float& vInf) {
+  float d1 = v1 - v0;
+  float d2 = v2 - v1;
+  float den = d1 - d2;                          // == 2*v1 - v0 - v2
+  if (d1 * d2 <= 0.0f) return false;            // not monotone
+  if (fabsf(d2) >= fabsf(d1)) return false;     // not decaying
+  if (fabsf(den) < 1e-6f) return false;
+  vInf = v2 + d2 * d2 / den;                    // algebraically == Aitken form, better conditioned
+  return true;
+}
+
+float tdsSettleAndRead() {
+  if (!tdsPowered) tdsPowerOn();
+
+  const unsigned long deadline = tdsPoweredAt + TDS_POWER_SETTLE_MS;
+  unsigned long at = tdsPoweredAt + TDS_SETTLE_MIN_MS;
+
+  float v[3];
+  uint8_t n = 0;
+  float prevInf = 0.0f;
+  bool  havePrev = false;
+  float result = 0.0f;
+  bool  early = false;
+
+  while ((long)(deadline - at) > 0) {
+    waitUntil(at);
+    float now = tdsReadVoltage();
+    if (n < 3) {
+      v[n++] = now;
+    } else {
+      v[0] = v[1]; v[1] = v[2]; v[2] = now;
+    }
+    at += TDS_SETTLE_STEP_MS;
+    if (n < 3) continue;
+
+    // Already flat: nothing left to extrapolate.
+    if (fabsf(v[2] - v[1]) < TDS_SETTLE_FIT_TOL_V &&
+        fabsf(v[1] - v[0]) < TDS_SETTLE_FIT_TOL_V) {
+      result = v[2];
+      early  = true;
+      break;
+    }
+
+    float vInf;
+    if (!fitAsymptote(v[0], v[1], v[2], vInf)) {
+      havePrev = false;
+      continue;
+    }
+    bool consistent = havePrev && fabsf(vInf - prevInf) < TDS_SETTLE_FIT_TOL_V;
+    prevInf  = vInf;
+    havePrev = true;
+    if (consistent && fabsf(vInf - v[2]) < TDS_SETTLE_MAX_EXTRAP_V) {
+      result = vInf;
+      early  = true;
+      break;
+    }
+  }
+
+  unsigned long settleMs = millis() - tdsPoweredAt;
+  if (!early) {
+    waitUntil(deadline);
+    result   = tdsReadVoltage();
+    settleMs = millis() - tdsPoweredAt;
   }
-  return v;
+
+  Serial.print("[TDS] Settle: ");
+  Serial.print(early ? "predicted " : "timed ");
+  Serial.print(result, 4);
+  Serial.print(" V after ");
+  Serial.print(settleMs);
+  Serial.print(" ms (saved ");
+  Serial.print(settleMs < TDS_POWER_SETTLE_MS ? TDS_POWER_SETTLE_MS - settleMs : 0UL);
+  Serial.println(" ms)");
+
+#if TDS_SETTLE_VALIDATE
+  if (early) {
+    waitUntil(deadline);
+    float measured = tdsReadVoltage();
+    Serial.print("[TDS] Settle check: predicted ");
+    Serial.print(result, 4);
+    Serial.print(" V, measured ");
+    Serial.print(measured, 4);
+    Serial.print(" V at ");
+    Serial.print(TDS_POWER_SETTLE_MS);
+    Serial.print(" ms, error ");
+    Serial.print((result - measured) * 1000.0f, 1);
+    Serial.println(" mV");
+  }
+#endif
+
+  return result;
 }
 
 float voltageToEC(float voltage, float temperature) {
@@ -229,35 +328,63 @@ void tdsCalBegin() {
 }
 
 /**
- * Sample the probe over TDS_CAL_STABILITY_WINDOW_MS and report the median
- * voltage and the peak-to-peak spread across the window. A large spread means
- * the probe has not equilibrated, so the caller refuses to capture.
+ * Slide a TDS_CAL_STABILITY_WINDOW_MS window over the probe reading until its
+ * peak-to-peak spread is under TDS_CAL_STABILITY_MAX_SPREAD, or until
+ * TDS_CAL_CAPTURE_TIMEOUT_MS. `median` and `spread` hold the last full window
+ * either way (spread stays negative if the window never filled).
  *
  * During calibration the probe is pinned ON by the calibration screen, so each
  * tdsReadVoltage() below just samples (no per-call power cycling).
  */
-static void measureStabilityTDS(float& median, float& spread) {
+static bool captureStableTDS(float& median, float& spread, SettleProgressFn progress) {
+  const unsigned long t0 = millis();
   const int N = TDS_CAL_STABILITY_WINDOW_MS / TDS_CAL_STABILITY_SAMPLE_MS;
-  float buf[N];
-  for (int i = 0; i < N; i++) {
-    // Each sample is itself a median of TDS_SAMPLE_COUNT raw reads: robust
-    // filtering at two levels — in-sample noise rejection here, and
-    // across-sample equilibration detection below.
-    buf[i] = tdsReadVoltage();
-    if (i < N - 1) delay(TDS_CAL_STABILITY_SAMPLE_MS);
-  }
 
-  float vMin = buf[0], vMax = buf[0];
-  for (int i = 1; i < N; i++) {
-    if (buf[i] < vMin) vMin = buf[i];
-    if (buf[i] > vMax) vMax = buf[i];
-  }
-  spread = vMax - vMin;
+  // Running statistic from the background sampler. The window fills while the
+  // calibration screen holds the probe powered, so by the time the user
+  // presses capture it is normally ready. Without the sampler, readings are
+  // shifted through our own window at the same spacing.
+  const bool sampled = analogSamplerRunning() && tdsPowered;
+  RobustFilter<N> window;
+
+  median = 0.0f;
+  spread = -1.0f;
+  while (true) {
+    bool full;
+    if (sampled) {
+      float mCounts, sCounts;
+      full = analogSamplerStability(ANALOG_CH_TDS, TDS_CAL_STABILITY_WINDOW_MS, mCounts, sCounts);
+      if (full) {
+        median = analogCountsToVolts(mCounts);
+        spread = analogCountsToVolts(sCounts);
+      }
+    } else {
+      // Each sample is itself a median of TDS_SAMPLE_COUNT raw reads: robust
+      // filtering at two levels — in-sample noise rejection here, and
+      // across-sample equilibration detection below.
+      window.push(tdsReadVoltage());
+      full = window.full();
+      if (full) {
+        median = window.median();
+        spread = window.spread();
+      }
+    }
+
+    if (full && spread <= TDS_CAL_STABILITY_MAX_SPREAD) return true;
 
-  median = medianOfTDS(buf, N);
+    unsigned long elapsed = millis() - t0;
+    if (progress) {
+      SettleProgress p = { full ? spread * 1000.0f : -1.0f,
+                           TDS_CAL_STABILITY_MAX_SPREAD * 1000.0f,
+                           elapsed, TDS_CAL_CAPTURE_TIMEOUT_MS };
+      progress(p);
+    }
+    if (elapsed >= TDS_CAL_CAPTURE_TIMEOUT_MS) return false;
+    delay(sampled ? ANALOG_STAB_BLOCK_MS : TDS_CAL_STABILITY_SAMPLE_MS);
+  }
 }
 
-bool tdsCalCapture(float standardTempC) {
+bool tdsCalCapture(float standardTempC, SettleProgressFn progress) {
   if (tdsCalStep != TDS_CAL_LOW && tdsCalStep != TDS_CAL_HIGH) {
     if (tdsCalStep == TDS_CAL_DONE) {
       Serial.println("[TDS] Already done — call tdsCalSave() or tdsCalBegin() to restart.");
@@ -267,15 +394,20 @@ bool tdsCalCapture(float standardTempC) {
     return false;
   }
 
+  unsigned long t0 = millis();
   float v, spread;
-  measureStabilityTDS(v, spread);
+  bool stable = captureStableTDS(v, spread, progress);
 
   Serial.print("[TDS] Stability: spread = ");
   Serial.print(spread * 1000.0f, 1);
-  Serial.println(" mV over window.");
-
-  if (spread > TDS_CAL_STABILITY_MAX_SPREAD) {
-    Serial.print("[TDS] REJECTED: probe not stable (need <");
+  Serial.print(" mV over window, after ");
+  Serial.print(millis() - t0);
+  Serial.println(" ms.");
+
+  if (!stable) {
+    Serial.print("[TDS] REJECTED: probe not stable within ");
+    Serial.print(TDS_CAL_CAPTURE_TIMEOUT_MS / 1000);
+    Serial.print(" s (need <");
     Serial.print(TDS_CAL_STABILITY_MAX_SPREAD * 1000.0f, 0);
     Serial.println(" mV). Wait for equilibration and retry.");
     return false;
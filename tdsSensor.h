@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <EEPROM.h>
+#include "AnalogSampler.h"
 
 // ============================================================================
 // CONDUCTIVITY / TDS / SPECIFIC-GRAVITY SENSOR
@@ -39,10 +40,10 @@
 //   and the lab note shipped with this module.
 //
 // ----------------------------------------------------------------------------
-// ADC CONTRACT (matches pHSensor): the ADC reference (5.0 V) and resolution
-// (10-bit / 1023) MUST stay identical to every other analog module. The sketch
-// never calls analogReadResolution(), so the ADC is in its 10-bit default;
-// changing it here would silently corrupt pH AND temperature readings too.
+// ADC CONTRACT (shared with pHSensor): the reference voltage, converter
+// resolution and oversampling live ONLY in AnalogSampler.h, and every module
+// converts counts with analogCountsToVolts(). Calibration points are volts, so
+// changing the resolution there does not invalidate stored calibrations.
 // ============================================================================
 
 
@@ -67,6 +68,31 @@
 // power-on still looks like it is climbing.
 #define TDS_POWER_SETTLE_MS    2000
 
+// ---- Predictive settle ----
+// The isolator output approaches its final value like a first-order step
+// response, v(t) = vInf - A*exp(-t/tau). Three EQUALLY spaced readings
+// v0, v1, v2 of such a curve determine vInf exactly:
+//   vInf = (v0*v2 - v1^2) / (v0 + v2 - 2*v1)      (Aitken delta-squared)
+// tdsSettleAndRead() takes a reading every TDS_SETTLE_STEP_MS from
+// TDS_SETTLE_MIN_MS after power-on, fits each sliding triple, and returns the
+// extrapolated vInf as soon as
+//   - two successive fits agree within TDS_SETTLE_FIT_TOL_V (the curve really
+//     is exponential, not noise), and
+//   - the predicted remaining creep |vInf - newest| is under
+//     TDS_SETTLE_MAX_EXTRAP_V (never trust a long extrapolation).
+// A reading that has simply stopped moving (all steps under the fit tolerance)
+// also ends the wait. TDS_POWER_SETTLE_MS stays the hard upper bound; if no
+// fit qualifies by then the plain reading at that point is used, as before.
+#define TDS_SETTLE_MIN_MS         300    // skip the gate-switch transient
+#define TDS_SETTLE_STEP_MS        150    // spacing between fitted readings
+#define TDS_SETTLE_FIT_TOL_V    0.002f   // successive vInf estimates must agree
+#define TDS_SETTLE_MAX_EXTRAP_V 0.050f   // max predicted creep we extrapolate over
+
+// Validation: after an early prediction, keep waiting to TDS_POWER_SETTLE_MS
+// and log the measured voltage next to the prediction. Costs the time the
+// predictor saves, so leave at 0 except when characterising a unit.
+#define TDS_SETTLE_VALIDATE        0
+
 // ============================================
 // CALIBRATION REFERENCE SOLUTIONS  (DFR0300 K=1 standards)
 // ============================================
@@ -144,16 +170,32 @@
 // A median of N reads rejects mains hum and the odd ADC/ESD spike far better
 // than a mean (one outlier can drag a mean by tens of mV; the median ignores
 // it). Same philosophy as the pH module.
-#define TDS_SAMPLE_COUNT   15
+// tdsReadVoltage() returns the boxcar mean of the newest TDS_SYNC_CYCLES
+// whole mains cycles from the background sampler (AnalogSampler.h), which
+// only fills while the probe is powered. 2 cycles = 8 evenly spaced counts,
+// about half the old median of 15, with the hum cancelled rather than voted
+// out. The blocking fallback (no timer) is a Hampel-screened mean of
+// TDS_SAMPLE_COUNT reads.
+#define TDS_SYNC_CYCLES    2
+#define TDS_SAMPLE_COUNT   9
 #define TDS_SAMPLE_DELAY   5     // ms between raw samples
 
 // ---- Calibration stability gate ----
-// On capture, the probe is watched over a short window and the point is only
-// accepted once it has stopped moving. Prevents locking in a calibration point
+// On capture, the point is only accepted once the probe has stopped moving:
+// the peak-to-peak spread over the newest TDS_CAL_STABILITY_WINDOW_MS must be
+// under TDS_CAL_STABILITY_MAX_SPREAD. Prevents locking in a calibration point
 // while the reading is still settling — a classic source of bad calibrations.
-#define TDS_CAL_STABILITY_WINDOW_MS   2000   // total watch window (ms)
+//
+// The window SLIDES: it is re-evaluated every sample until it passes or
+// TDS_CAL_CAPTURE_TIMEOUT_MS runs out, so a press that lands on a transient
+// waits only until the transient has left the window instead of failing and
+// costing another full window. With the background sampler the window has
+// been filling since the calibration screen powered the probe, so a settled
+// probe is accepted on the first evaluation.
+#define TDS_CAL_STABILITY_WINDOW_MS   2000   // sliding window length (ms)
 #define TDS_CAL_STABILITY_SAMPLE_MS    100   // gap between window samples (ms)
 #define TDS_CAL_STABILITY_MAX_SPREAD   0.015f // max peak-to-peak (V) to accept
+#define TDS_CAL_CAPTURE_TIMEOUT_MS   20000   // reject the capture after this
 
 // ============================================
 // SPECIFIC GRAVITY MODEL
@@ -181,7 +223,7 @@
 // ============================================
 //
 // Device EEPROM map:
-//   0x00  pH calibration   (PH_EEPROM_ADDR)
+//   0x00  pH calibration, legacy 3-point (PH_LEGACY_EEPROM_ADDR)
 //   0x20  TDS calibration   <-- here  (must stay < 0x40)
 //   0x40  BLE settings      (BLE_EEPROM_ADDR)
 #define TDS_EEPROM_ADDR    0x20
@@ -269,9 +311,19 @@ void tdsSensorInit();
 // ---- Power gate ----
 void tdsPowerOn();           // energise probe (high-side gate ON); records state
 void tdsPowerOff();          // de-energise probe (gate OFF); probe dark between tests
-void tdsPowerOnAndSettle();  // power ON and block for the full settle window
+void tdsPowerOnAndSettle();  // power ON and block until settled (predictive, see above)
 bool tdsIsPowered();         // true while the probe is currently powered
 
+/**
+ * Block until the powered probe has settled and return its voltage: the
+ * extrapolated asymptote if the predictor qualified early, else a plain
+ * reading at TDS_POWER_SETTLE_MS after power-on. Time already spent powered
+ * (e.g. the pH read in startTest) counts towards the window. Logs the
+ * settle time and how much of the fixed window it saved.
+ * Powers the probe on first if it is off.
+ */
+float tdsSettleAndRead();
+
 // ---- Reading ----
 
 /**
@@ -350,10 +402,11 @@ void tdsSetSGCalibration(float slope, float offset);
 void tdsCalBegin();
 
 /**
- * Capture the current reading for the active step, with a stability check: the
- * reading is watched for TDS_CAL_STABILITY_WINDOW_MS and accepted only if its
- * peak-to-peak spread is under TDS_CAL_STABILITY_MAX_SPREAD volts. On success
- * the point is stored and the step advances.
+ * Capture the current reading for the active step, with a stability check: a
+ * TDS_CAL_STABILITY_WINDOW_MS window slides over the reading until its
+ * peak-to-peak spread is under TDS_CAL_STABILITY_MAX_SPREAD volts, for at most
+ * TDS_CAL_CAPTURE_TIMEOUT_MS. On success the point is stored and the step
+ * advances. `progress`, if given, gets the spread in mV at every evaluation.
  *
  * Pass the MEASURED standard temperature for best accuracy (the standards are
  * almost never at exactly TDS_TEMP_REF_C). The default keeps the old no-arg
@@ -363,9 +416,11 @@ void tdsCalBegin();
  *   Recommended:  tdsCalCapture(pHReadTemperature());
  *
  * @param standardTempC temperature of the standard solution, degC.
+ * @param progress      optional settling callback for the calibration screen.
  * @return true if a stable point was captured, false if rejected (retry).
  */
-bool tdsCalCapture(float standardTempC = TDS_TEMP_REF_C);
+bool tdsCalCapture(float standardTempC = TDS_TEMP_REF_C,
+                   SettleProgressFn progress = nullptr);
 
 /** Persist the completed calibration to EEPROM (call when step == DONE). */
 void tdsCalSave();
@@ -0,0 +1,188 @@
+// ============================================
+// HOST HARNESS: AnalogSampler
+// ============================================
+//
+// Checks the pieces of the background sampler that are pure signal
+// processing: the Goertzel mains detector, the mains-synchronous boxcar and
+// the stability-block sequence that pHReadEndpoint() uses to ignore history.
+// A fake analogRead() returns a DC level plus synthetic hum, evaluated on a
+// simulated microsecond clock; the timer stub fires the sampler's ISR on
+// demand, one tick period apart on that clock.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -Wall -I test/host/stubs -I . test/host/analog_sampler_test.cpp -o /tmp/analog_sampler_test
+//   /tmp/analog_sampler_test
+//
+// Exits non-zero if any check fails. AnalogSampler.cpp is included directly
+// so its static helpers can be called without exporting them.
+
+#include "../../AnalogSampler.cpp"
+
+// ============================================
+// SIMULATED HARDWARE
+// ============================================
+
+HostSerial Serial;
+void (*FspTimer::callback)(timer_callback_args_t*) = nullptr;
+float FspTimer::frequency = 0.0f;
+
+static unsigned long simUs = 0;
+
+// Input at the ADC pin, in ANALOG_ADC_BITS units.
+struct Hum {
+  float dc;
+  float hz;
+  float amp[3];     // fundamental, 2nd and 3rd harmonic
+  float phase;      // radians, fundamental at t = 0
+};
+static Hum hum = { 8000.0f, 50.0f, { 0.0f, 0.0f, 0.0f }, 0.0f };
+
+// Every call advances the clock by 1 us, so the detector's busy-wait on
+// micros() terminates exactly as it does on the board.
+unsigned long micros() { return simUs++; }
+unsigned long millis() { return simUs / 1000UL; }
+void delay(unsigned long ms) { simUs += ms * 1000UL; }
+void analogReadResolution(int) {}
+
+int analogRead(uint8_t) {
+  float t = (float)simUs * 1e-6f;
+  float v = hum.dc;
+  for (int h = 0; h < 3; h++) {
+    v += hum.amp[h] * sinf((float)(h + 1) * ((float)TWO_PI * hum.hz * t + hum.phase));
+  }
+  return (int)lroundf(v);
+}
+
+/** Fire n sampler ticks, each one tick period after the last. */
+static void runTicks(int n) {
+  const double periodUs = 1e6 / (double)FspTimer::frequency;
+  double t = (double)simUs;
+  for (int i = 0; i < n; i++) {
+    simUs = (unsigned long)llround(t);
+    FspTimer::fire();
+    t += periodUs;
+  }
+}
+
+// ============================================
+// CHECKS
+// ============================================
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float got, float want) {
+  printf("%s  %-52s got %10.3f  want %10.3f\n", ok ? "PASS" : "FAIL", what, got, want);
+  if (!ok) failures++;
+}
+
+/** Goertzel on a synthetic 1 kHz record: right bin reads the amplitude, other bin and DC vanish. */
+static void testGoertzel() {
+  const int n = ANALOG_MAINS_DETECT_MS;
+  uint16_t x[ANALOG_MAINS_DETECT_MS];
+
+  const float freqs[] = { 50.0f, 60.0f };
+  for (float f : freqs) {
+    for (int i = 0; i < n; i++) {
+      x[i] = (uint16_t)lroundf(16000.0f + 120.0f * sinf((float)TWO_PI * f * i / 1000.0f + 0.7f));
+    }
+    float on  = goertzelAmplitude(x, n, f, 1000.0f);
+    float off = goertzelAmplitude(x, n, f == 50.0f ? 60.0f : 50.0f, 1000.0f);
+    check(fabsf(on - 120.0f) < 2.4f, f == 50.0f ? "goertzel 50 Hz bin, 50 Hz hum"
+                                                : "goertzel 60 Hz bin, 60 Hz hum", on, 120.0f);
+    check(off < 1.0f, f == 50.0f ? "goertzel 60 Hz bin, 50 Hz hum"
+                                 : "goertzel 50 Hz bin, 60 Hz hum", off, 0.0f);
+  }
+}
+
+/** Detection through the real init / re-detect path. */
+static void testDetect() {
+  hum.hz = 60.0f; hum.amp[0] = 40.0f; hum.amp[1] = 10.0f; hum.amp[2] = 0.0f;
+  analogSamplerInit();
+  check(analogSamplerMainsHz() == 60, "init detects 60 Hz", analogSamplerMainsHz(), 60);
+
+  hum.hz = 50.0f;
+  analogSamplerSetMainsHz(0);
+  check(analogSamplerMainsHz() == 50, "re-detect follows 50 Hz", analogSamplerMainsHz(), 50);
+
+  hum.hz = 60.0f;
+  analogSamplerSetMainsHz(0);
+  check(analogSamplerMainsHz() == 60, "re-detect follows 60 Hz", analogSamplerMainsHz(), 60);
+
+  // Below ANALOG_MAINS_DETECT_MIN_COUNTS: clean supply, fall back to the default.
+  hum.amp[0] = 0.5f; hum.amp[1] = 0.0f;
+  analogSamplerSetMainsHz(0);
+  check(analogSamplerMainsHz() == ANALOG_MAINS_DEFAULT_HZ, "no hum -> default",
+        analogSamplerMainsHz(), ANALOG_MAINS_DEFAULT_HZ);
+}
+
+/** Worst boxcar error over several hum phases, in counts. */
+static float boxcarWorstError(uint8_t lockHz, float humHz) {
+  const float want = hum.dc * (float)(1 << ANALOG_OVERSAMPLE_BITS);
+  hum.hz = humHz;
+  float worst = 0.0f;
+  for (int p = 0; p < 8; p++) {
+    hum.phase = (float)p * 0.785f;
+    analogSamplerSetMainsHz(lockHz);   // restarts the rings
+    runTicks(ANALOG_SAMPLER_RING_LEN);
+    float counts = 0.0f;
+    if (!analogSamplerBoxcar(ANALOG_CH_PH, 8, counts)) return 1e9f;
+    float err = fabsf(counts - want);
+    if (err > worst) worst = err;
+  }
+  return worst;
+}
+
+static void testBoxcar() {
+  // Strong hum with 2nd and 3rd harmonics: 400 / 120 / 60 counts peak.
+  hum.amp[0] = 200.0f; hum.amp[1] = 60.0f; hum.amp[2] = 30.0f;
+
+  // Empty ring right after (re)arming: no reading yet.
+  analogSamplerSetMainsHz(50);
+  float counts = 0.0f;
+  runTicks(ANALOG_SAMPLER_RING_LEN - 1);
+  check(!analogSamplerBoxcar(ANALOG_CH_PH, 8, counts), "boxcar refuses a part-filled ring", 0, 0);
+
+  // Locked to the hum: fundamental and harmonics cancel to rounding error.
+  float e50 = boxcarWorstError(50, 50.0f);
+  check(e50 < 1.0f, "boxcar locked 50 Hz, 50 Hz hum (worst error)", e50, 0.0f);
+  float e60 = boxcarWorstError(60, 60.0f);
+  check(e60 < 1.0f, "boxcar locked 60 Hz, 60 Hz hum (worst error)", e60, 0.0f);
+
+  // Locked to the wrong frequency the residual is large: sync is what works.
+  float eMis = boxcarWorstError(50, 60.0f);
+  check(eMis > 10.0f, "boxcar locked 50 Hz, 60 Hz hum (worst error)", eMis, 10.0f);
+
+  analogSamplerDisarm(ANALOG_CH_PH);
+  check(!analogSamplerBoxcar(ANALOG_CH_PH, 8, counts), "boxcar refuses a disarmed channel", 0, 0);
+}
+
+/** Block sequence: counts only blocks closed since it was read, across a re-arm. */
+static void testBlockSeq() {
+  analogSamplerSetMainsHz(50);
+  analogSamplerArm(ANALOG_CH_PH);
+  const int ticksPerBlock = stabBlockLen();
+  runTicks(ANALOG_STAB_BLOCKS * ticksPerBlock);   // a full ring of "old" history
+
+  float blocks[ANALOG_STAB_BLOCKS];
+  uint32_t seq0 = analogSamplerBlockSeq(ANALOG_CH_PH);
+  check(analogSamplerBlocks(ANALOG_CH_PH, blocks, ANALOG_STAB_BLOCKS) == ANALOG_STAB_BLOCKS,
+        "ring full of pre-call history", ANALOG_STAB_BLOCKS, ANALOG_STAB_BLOCKS);
+  runTicks(3 * ticksPerBlock);
+  float fresh = (float)(analogSamplerBlockSeq(ANALOG_CH_PH) - seq0);
+  check(fresh == 3.0f, "block seq counts only blocks since the call", fresh, 3.0f);
+
+  analogSamplerArm(ANALOG_CH_PH);                 // clears the ring, not the seq
+  runTicks(ticksPerBlock);
+  fresh = (float)(analogSamplerBlockSeq(ANALOG_CH_PH) - seq0);
+  check(fresh == 4.0f, "block seq keeps counting across a re-arm", fresh, 4.0f);
+}
+
+int main() {
+  testGoertzel();
+  testDetect();
+  testBoxcar();
+  testBlockSeq();
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
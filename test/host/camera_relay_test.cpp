@@ -0,0 +1,266 @@
+// ============================================
+// HOST HARNESS: camera thumbnail relay
+// ============================================
+//
+// Runs cameraRelayThumbnail() against a simulated ESP32-CAM on CAM_SERIAL.
+// The fake UART delivers bytes at CAM_BAUD on a simulated microsecond clock
+// into a receive ring the size of the R4's Serial1 buffer, and the fake ESP32
+// speaks the THUMB / C,<seq>,<len> / ACK / ABORT protocol from
+// cameraSensor.h. It checks:
+//
+//   - every chunk handed to the sink is at most CAM_THUMB_CHUNK_BYTES, and the
+//     receive ring never holds more than one chunk and its header, even
+//     behind a slow sink;
+//   - the image arrives byte for byte;
+//   - after a sink refuses begin() or rejects a chunk, the UART is drained of
+//     the chunk already on the wire, so the next command parses cleanly;
+//
+// and prints bytes/s for a fast and a slow (BLE-paced) sink.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -Wall -I test/host/stubs -I . test/host/camera_relay_test.cpp -o /tmp/camera_relay_test
+//   /tmp/camera_relay_test
+//
+// Exits non-zero if any check fails. cameraSensor.cpp is included directly.
+
+#define CAM_SERIAL camUart      // the fake below, instead of Serial1
+
+#include "../../cameraSensor.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+// ============================================
+// SIMULATED ESP32-CAM
+// ============================================
+
+static unsigned long simUs = 0;
+
+unsigned long micros() { return simUs; }
+unsigned long millis() { return simUs / 1000UL; }
+void delay(unsigned long ms) { simUs += ms * 1000UL; }
+
+#define FAKE_RX_RING_BYTES  512     // R4 core Serial1 receive buffer
+
+class FakeCamUart {
+public:
+  std::vector<uint8_t> image;       // the JPEG the camera "captured"
+  size_t   overflowed = 0;          // bytes lost to a full receive ring
+  unsigned aborts     = 0;
+
+  void begin(unsigned long) {}
+  void setTimeout(unsigned long) {}
+  void flush() {}
+
+  int available() {
+    deliver();
+    return (int)ring.size();
+  }
+
+  int read() {
+    deliver();
+    if (ring.empty()) return -1;
+    uint8_t b = ring.front();
+    ring.pop_front();
+    return b;
+  }
+
+  size_t readBytes(uint8_t* buf, size_t n) {
+    size_t got = 0;
+    while (got < n && available() > 0) buf[got++] = (uint8_t)read();
+    return got;
+  }
+
+  void print(const char* s) { while (*s) print(*s++); }
+
+  void print(char c) {
+    if (c != '\n') { line += c; return; }
+    command(line);
+    line.clear();
+  }
+
+  /** True once everything the ESP32 sent has arrived and been read. */
+  bool idle() { deliver(); return wire.empty() && ring.empty(); }
+
+private:
+  struct Timed { unsigned long at; uint8_t b; };
+  std::deque<Timed>   wire;         // sent by the ESP32, not yet arrived
+  std::deque<uint8_t> ring;         // arrived, not yet read
+  std::string line;
+  unsigned long txFreeAt = 0;       // when the ESP32's UART finishes its last byte
+  size_t   chunk = 0, sent = 0;
+  unsigned seq = 0;
+  bool     active = false;
+
+  static constexpr unsigned long BYTE_US = 10UL * 1000000UL / CAM_BAUD;
+
+  void send(const uint8_t* p, size_t n) {
+    if (txFreeAt < simUs) txFreeAt = simUs;
+    for (size_t i = 0; i < n; i++) {
+      txFreeAt += BYTE_US;
+      wire.push_back({ txFreeAt, p[i] });
+    }
+  }
+  void send(const char* s) { send((const uint8_t*)s, strlen(s)); }
+
+  void deliver() {
+    while (!wire.empty() && wire.front().at <= simUs) {
+      if (ring.size() < FAKE_RX_RING_BYTES) ring.push_back(wire.front().b);
+      else                                  overflowed++;
+      wire.pop_front();
+    }
+  }
+
+  void sendChunk() {
+    size_t len = min(chunk, image.size() - sent);
+    char hdr[24];
+    snprintf(hdr, sizeof(hdr), "C,%u,%u\n", seq, (unsigned)len);
+    send(hdr);
+    send(&image[sent], len);
+    sent += len;
+  }
+
+  void command(const std::string& cmd) {
+    unsigned v;
+    if (sscanf(cmd.c_str(), "THUMB,%u", &v) == 1) {
+      chunk = v; sent = 0; seq = 0; active = true;
+      char hdr[24];
+      snprintf(hdr, sizeof(hdr), "JPG,%u\n", (unsigned)image.size());
+      send(hdr);
+      sendChunk();
+    } else if (sscanf(cmd.c_str(), "ACK,%u", &v) == 1) {
+      if (active && v == seq && sent < image.size()) { seq++; sendChunk(); }
+      else active = false;
+    } else if (cmd == "ABORT") {
+      active = false;
+      aborts++;
+    } else if (cmd == "PING") {
+      send("PONG\n");
+    }
+  }
+};
+
+static FakeCamUart camUart;
+
+#include "../../cameraSensor.cpp"
+
+HostSerial Serial;
+
+// ============================================
+// SINKS
+// ============================================
+
+static std::vector<uint8_t> received;
+static size_t   maxChunk     = 0;
+static unsigned chunkDelayMs = 0;      // simulated BLE time per chunk
+static int      rejectAt     = -1;     // chunk index to reject, -1 = never
+static bool     refuseBegin  = false;
+static int      ends         = 0;
+static bool     endOk        = false;
+
+static bool sinkBegin(uint32_t) {
+  received.clear();
+  maxChunk = 0;
+  return !refuseBegin;
+}
+
+static bool sinkChunk(const uint8_t* data, size_t len) {
+  if (rejectAt >= 0 && (int)(received.size() / CAM_THUMB_CHUNK_BYTES) == rejectAt) return false;
+  if (len > maxChunk) maxChunk = len;
+  received.insert(received.end(), data, data + len);
+  delay(chunkDelayMs);
+  return true;
+}
+
+static void sinkEnd(bool ok) {
+  ends++;
+  endOk = ok;
+}
+
+static const CamThumbSink sink = { sinkBegin, sinkChunk, sinkEnd };
+
+static void resetSink(unsigned delayMs, int reject, bool refuse) {
+  chunkDelayMs = delayMs;
+  rejectAt     = reject;
+  refuseBegin  = refuse;
+  ends         = 0;
+  endOk        = false;
+}
+
+// ============================================
+// CHECKS
+// ============================================
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float got, float want) {
+  printf("%s  %-52s got %10.3f  want %10.3f\n", ok ? "PASS" : "FAIL", what, got, want);
+  if (!ok) failures++;
+}
+
+// Header "C,<seq>,<len>\n" is at most 16 bytes for a 16 KB image.
+static const float RX_BOUND = CAM_THUMB_CHUNK_BYTES + 16;
+
+/** One full relay; checks the bound and the content, returns bytes/s. */
+static float relayOnce(const char* label, unsigned delayMs) {
+  resetSink(delayMs, -1, false);
+  CamThumbStats st = cameraRelayThumbnail(sink);
+  char what[64];
+  snprintf(what, sizeof(what), "%s: transfer completes", label);
+  check(st.ok && ends == 1 && endOk, what, st.ok, 1);
+  snprintf(what, sizeof(what), "%s: image arrives intact", label);
+  check(received == camUart.image, what, (float)received.size(), (float)camUart.image.size());
+  snprintf(what, sizeof(what), "%s: largest sink chunk", label);
+  check(maxChunk <= CAM_THUMB_CHUNK_BYTES, what, (float)maxChunk, CAM_THUMB_CHUNK_BYTES);
+  snprintf(what, sizeof(what), "%s: peak RX ring use", label);
+  check(st.peakRxBytes <= RX_BOUND && camUart.overflowed == 0, what, st.peakRxBytes, RX_BOUND);
+  return st.elapsedMs ? st.bytes * 1000.0f / st.elapsedMs : 0.0f;
+}
+
+/** A sink that refuses begin(): ABORT, drain, and the next relay is clean. */
+static void testRefusedBegin() {
+  resetSink(0, -1, true);
+  unsigned aborts = camUart.aborts;
+  CamThumbStats st = cameraRelayThumbnail(sink);
+  check(!st.ok && camUart.aborts == aborts + 1, "refused begin sends ABORT", camUart.aborts - aborts, 1);
+  check(ends == 0, "refused begin gets no end()", ends, 0);
+  check(camUart.idle(), "refused begin leaves the UART drained", camUart.idle(), 1);
+
+  relayOnce("after refusal", 0);
+}
+
+/** A sink that drops mid-transfer: ABORT, drain, end(false), next relay clean. */
+static void testRejectedChunk() {
+  resetSink(0, 3, false);
+  unsigned aborts = camUart.aborts;
+  CamThumbStats st = cameraRelayThumbnail(sink);
+  check(!st.ok && st.bytes == 3 * CAM_THUMB_CHUNK_BYTES, "rejected chunk stops the relay",
+        st.bytes, 3 * CAM_THUMB_CHUNK_BYTES);
+  check(camUart.aborts == aborts + 1 && ends == 1 && !endOk, "rejected chunk: ABORT and end(false)",
+        ends, 1);
+  check(camUart.idle(), "rejected chunk leaves the UART drained", camUart.idle(), 1);
+
+  relayOnce("after rejection", 0);
+}
+
+int main() {
+  // A ~6 KB "JPEG" of pseudo-random bytes, newlines and all.
+  uint32_t x = 0x12345678;
+  for (int i = 0; i < 6000; i++) {
+    x = x * 1664525u + 1013904223u;
+    camUart.image.push_back((uint8_t)(x >> 24));
+  }
+  camOnline = true;
+
+  float fast = relayOnce("fast sink", 0);
+  // ~7.5 ms per 128 B: a 185-byte-MTU link with a few notifications per event.
+  float slow = relayOnce("slow sink", 8);
+  testRefusedBegin();
+  testRejectedChunk();
+
+  printf("RATE  fast sink %.0f B/s, slow sink %.0f B/s (UART line rate %lu B/s)\n",
+         fast, slow, (unsigned long)(CAM_BAUD / 10));
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
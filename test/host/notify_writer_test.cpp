@@ -0,0 +1,160 @@
+// ============================================
+// HOST HARNESS: NotifyWriter
+// ============================================
+//
+// Feeds NotifyWriter through a stub characteristic that records every
+// notification and can start refusing them part way (as writeValue() does
+// once the central disconnects or unsubscribes). Checks that every packet
+// but the last is exactly (ATT MTU - 3) bytes for the legacy and the largest
+// MTU, whatever the write sizes, that the payload arrives intact, and that
+// after a refused notification write() returns 0, nothing more is sent and
+// finish() / ok() report the failure.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -Wall -I test/host/stubs -I . test/host/notify_writer_test.cpp -o /tmp/notify_writer_test
+//   /tmp/notify_writer_test
+//
+// Exits non-zero if any check fails. NotifyWriter.cpp is included directly.
+
+#include "../../NotifyWriter.cpp"
+
+#include <vector>
+
+// ============================================
+// SIMULATED LINK
+// ============================================
+
+HostSerial Serial;
+
+static unsigned long simMs = 0;
+
+unsigned long millis() { return simMs; }
+unsigned long micros() { return simMs * 1000UL; }
+void delay(unsigned long ms) { simMs += ms; }
+
+static std::vector<std::vector<uint8_t>> packets;
+static int refuseFrom = -1;     // index of the first refused notification, -1 = never
+static int attempts   = 0;
+
+static int onWrite(const uint8_t* value, int len) {
+  int n = attempts++;
+  if (refuseFrom >= 0 && n >= refuseFrom) return 0;
+  packets.emplace_back(value, value + len);
+  simMs += 1;                   // ~one notification per ms
+  return 1;
+}
+
+static BLECharacteristic chr;
+
+static void resetLink(int refuse) {
+  packets.clear();
+  attempts   = 0;
+  refuseFrom = refuse;
+  chr.onWrite = onWrite;
+}
+
+// ============================================
+// CHECKS
+// ============================================
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float got, float want) {
+  printf("%s  %-52s got %10.3f  want %10.3f\n", ok ? "PASS" : "FAIL", what, got, want);
+  if (!ok) failures++;
+}
+
+static std::vector<uint8_t> payload(size_t n) {
+  std::vector<uint8_t> p(n);
+  for (size_t i = 0; i < n; i++) p[i] = (uint8_t)(i * 7 + 3);
+  return p;
+}
+
+/** Write `total` bytes in pieces of `step` and check the packetisation. */
+static void testFill(uint16_t mtu, size_t total, size_t step) {
+  resetLink(-1);
+  std::vector<uint8_t> p = payload(total);
+  NotifyWriter w(chr, mtu);
+  for (size_t off = 0; off < total; off += step) {
+    size_t n = min(step, total - off);
+    if (w.write(&p[off], n) != n) break;
+  }
+  bool ok = w.finish(0);
+
+  const size_t full = mtu - 3;
+  bool filled = true;
+  std::vector<uint8_t> got;
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (i + 1 < packets.size() ? packets[i].size() != full
+                               : packets[i].empty() || packets[i].size() > full) filled = false;
+    got.insert(got.end(), packets[i].begin(), packets[i].end());
+  }
+
+  char what[64];
+  snprintf(what, sizeof(what), "MTU %u, %u B in %u B writes: packets full", mtu,
+           (unsigned)total, (unsigned)step);
+  check(filled && w.packetBytes() == full, what, (float)packets[0].size(), (float)full);
+  snprintf(what, sizeof(what), "MTU %u, %u B in %u B writes: count", mtu,
+           (unsigned)total, (unsigned)step);
+  float want = (float)((total + full - 1) / full);
+  check(packets.size() == want, what, (float)packets.size(), want);
+  snprintf(what, sizeof(what), "MTU %u, %u B in %u B writes: intact", mtu,
+           (unsigned)total, (unsigned)step);
+  check(ok && w.ok() && got == p, what, (float)got.size(), (float)total);
+}
+
+/** A refused notification stops the writer and is reported. */
+static void testFailure() {
+  const uint16_t mtu = 23;
+  resetLink(2);
+  std::vector<uint8_t> p = payload(200);
+  NotifyWriter w(chr, mtu);
+
+  size_t r1 = w.write(&p[0], 40);       // two full packets, both accepted
+  check(r1 == 40 && w.ok(), "writes before the failure are accepted", (float)r1, 40);
+  size_t r2 = w.write(&p[40], 40);      // third packet refused
+  check(r2 == 0 && !w.ok(), "write() returns 0 once a notify is refused", (float)r2, 0);
+  size_t r3 = w.write(&p[80], 40);
+  check(r3 == 0 && attempts == 3, "nothing more is sent after the failure", (float)attempts, 3);
+  check(!w.finish(0), "finish() reports the failure", 0, 0);
+  check(attempts == 3 && packets.size() == 2, "finish() does not retry the failed packet",
+        (float)attempts, 3);
+
+  // Failure on the final partial packet, sent only by finish().
+  resetLink(1);
+  NotifyWriter v(chr, mtu);
+  size_t r4 = v.write(&p[0], 30);       // one full packet + 10 B pending
+  check(r4 == 30 && v.ok(), "partial packet is held until finish()", (float)packets.size(), 1);
+  check(!v.finish(0) && !v.ok(), "finish() reports a refused last packet", v.ok(), 0);
+}
+
+/** Values outside the buffer are clamped; print() goes through write(). */
+static void testEdges() {
+  resetLink(-1);
+  NotifyWriter big(chr, 517);
+  check(big.packetBytes() == NOTIFY_PACKET_MAX_BYTES, "MTU above the buffer is clamped",
+        (float)big.packetBytes(), NOTIFY_PACKET_MAX_BYTES);
+
+  NotifyWriter w(chr, 23);
+  w.write("hello, ");
+  w.write('x');
+  check(w.finish(0) && packets.size() == 1 && packets[0].size() == 8,
+        "small text write is one notification", (float)packets[0].size(), 8);
+
+  resetLink(-1);
+  NotifyWriter e(chr, 23);
+  check(e.finish(0) && packets.empty(), "empty writer sends nothing", (float)packets.size(), 0);
+}
+
+int main() {
+  const size_t steps[] = { 1, 7, 20, 64, 1000 };
+  for (uint16_t mtu : { (uint16_t)23, (uint16_t)185 }) {
+    for (size_t step : steps) testFill(mtu, 1000, step);
+    testFill(mtu, mtu - 3, 1);            // exactly one packet
+  }
+  testFailure();
+  testEdges();
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// ============================================
+// HOST HARNESS: RobustFilter
+// ============================================
+//
+// Checks the sliding-window median, spread, MAD and Hampel mean against a
+// plain sort of the same window, over random data with and without repeated
+// values, then times one push + median per read against the insertion sort
+// the pH and TDS modules used before (copy the window, sort, take the middle)
+// at N = 10, 15 and 64.
+//
+// Build and run from the repository root (-O2 so the timings mean something):
+//
+//   g++ -std=c++17 -O2 -Wall -I test/host/stubs -I . test/host/robust_filter_test.cpp -o /tmp/robust_filter_test
+//   /tmp/robust_filter_test
+//
+// Exits non-zero if any check fails. The timings are printed, not checked.
+
+#include "../../RobustFilter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+HostSerial Serial;
+
+// ============================================
+// REFERENCE
+// ============================================
+
+static float refMedian(std::vector<float> v) {
+  std::sort(v.begin(), v.end());
+  size_t n = v.size();
+  return (n & 1) ? v[n / 2] : 0.5f * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static float refMad(const std::vector<float>& v) {
+  float med = refMedian(v);
+  std::vector<float> d;
+  for (float x : v) d.push_back(fabsf(x - med));
+  return refMedian(d);
+}
+
+/** The pre-RobustFilter helper: insertion sort a copy, return the middle. */
+static float insertionMedian(const float* src, int n) {
+  float arr[64];
+  memcpy(arr, src, n * sizeof(float));
+  for (int i = 1; i < n; i++) {
+    float key = arr[i];
+    int j = i - 1;
+    while (j >= 0 && arr[j] > key) {
+      arr[j + 1] = arr[j];
+      j--;
+    }
+    arr[j + 1] = key;
+  }
+  return arr[n / 2];
+}
+
+// ============================================
+// CHECKS
+// ============================================
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float got, float want) {
+  printf("%s  %-52s got %10.3f  want %10.3f\n", ok ? "PASS" : "FAIL", what, got, want);
+  if (!ok) failures++;
+}
+
+/**
+ * Slide a window over `reads` random values; after every push compare the
+ * filter with a sort of the same values. Returns the worst error seen.
+ */
+template <uint8_t N>
+static float worstError(std::mt19937& rng, int levels, int reads, bool mad) {
+  std::uniform_int_distribution<int> dist(0, levels - 1);
+  RobustFilter<N> f;
+  std::vector<float> window;
+  float worst = 0.0f;
+  for (int i = 0; i < reads; i++) {
+    float x = (float)dist(rng) * 0.25f;
+    f.push(x);
+    window.push_back(x);
+    if (window.size() > N) window.erase(window.begin());
+
+    float got  = mad ? f.medianAbsDeviation() : f.median();
+    float want = mad ? refMad(window)         : refMedian(window);
+    worst = std::max(worst, fabsf(got - want));
+    if (!mad) {
+      auto mm = std::minmax_element(window.begin(), window.end());
+      worst = std::max(worst, fabsf(f.spread() - (*mm.second - *mm.first)));
+    }
+  }
+  return worst;
+}
+
+template <uint8_t N>
+static void testAgainstSort(std::mt19937& rng) {
+  char what[64];
+  // 1000 levels: mostly distinct values. 4 levels: many ties, MAD often 0.
+  for (int levels : { 1000, 4 }) {
+    snprintf(what, sizeof(what), "N=%u median/spread, %d levels", N, levels);
+    float e = worstError<N>(rng, levels, 2000, false);
+    check(e == 0.0f, what, e, 0.0f);
+    snprintf(what, sizeof(what), "N=%u MAD, %d levels", N, levels);
+    e = worstError<N>(rng, levels, 2000, true);
+    check(e == 0.0f, what, e, 0.0f);
+  }
+}
+
+/** A spike leaves the Hampel mean at the mean of the rest; a real step still shows. */
+static void testHampel() {
+  RobustFilter<9> f;
+  const float base[] = { 1.00f, 1.02f, 0.98f, 1.01f, 0.99f, 1.00f, 1.03f, 0.97f };
+  float sum = 0.0f;
+  for (float x : base) { f.push(x); sum += x; }
+  f.push(40.0f);
+  check(fabsf(f.hampelMean() - sum / 8.0f) < 1e-5f, "hampelMean drops a single spike",
+        f.hampelMean(), sum / 8.0f);
+
+  RobustFilter<9> g;
+  for (int i = 0; i < 4; i++) g.push(1.0f);
+  for (int i = 0; i < 5; i++) g.push(2.0f);
+  check(g.hampelMean() == 2.0f, "hampelMean follows a step past half the window",
+        g.hampelMean(), 2.0f);
+
+  RobustFilter<9> h;
+  check(h.hampelMean() == 0.0f, "hampelMean of an empty window", h.hampelMean(), 0.0f);
+}
+
+// ============================================
+// TIMING
+// ============================================
+
+static volatile float sink;
+
+template <uint8_t N>
+static void bench(std::mt19937& rng) {
+  const int reads = 200000;
+  std::uniform_real_distribution<float> dist(0.0f, 5.0f);
+  std::vector<float> data(reads + N);
+  for (float& x : data) x = dist(rng);
+
+  // Old: keep the newest N in an array, sort a copy per read.
+  auto t0 = std::chrono::steady_clock::now();
+  float acc = 0.0f;
+  for (int i = 0; i < reads; i++) acc += insertionMedian(&data[i], N);
+  auto t1 = std::chrono::steady_clock::now();
+  sink = acc;
+
+  // New: one push + median per read.
+  RobustFilter<N> f;
+  for (int i = 0; i < N; i++) f.push(data[i]);
+  auto t2 = std::chrono::steady_clock::now();
+  acc = 0.0f;
+  for (int i = 0; i < reads; i++) {
+    f.push(data[i + N]);
+    acc += f.median();
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  sink = acc;
+
+  double oldNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / reads;
+  double newNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / reads;
+  printf("TIME  N=%-3u insertion sort %7.1f ns/read, RobustFilter %6.1f ns/read (%.1fx)\n",
+         N, oldNs, newNs, oldNs / newNs);
+}
+
+int main() {
+  std::mt19937 rng(12345);
+  testAgainstSort<10>(rng);
+  testAgainstSort<15>(rng);
+  testAgainstSort<64>(rng);
+  testHampel();
+
+  bench<10>(rng);
+  bench<15>(rng);
+  bench<64>(rng);
+
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_STUB_ARDUINO_H
+#define HOST_STUB_ARDUINO_H
+
+// Just enough of the Arduino core for the host harnesses in test/host. The
+// clock, analogRead() and Serial are defined by each harness.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define A0 14
+#define A1 15
+#define TWO_PI 6.283185307179586476925286766559
+
+#define noInterrupts() ((void)0)
+#define interrupts()   ((void)0)
+
+template <typename T> T min(T a, T b) { return b < a ? b : a; }
+template <typename T> T max(T a, T b) { return a < b ? b : a; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+int  analogRead(uint8_t pin);
+void analogReadResolution(int bits);
+
+/** Byte sink base class, as in the Arduino core (write() only). */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*data++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+};
+
+/** Serial that writes to stdout (decimal places honoured for floats). */
+struct HostSerial {
+  void print(const char* s)             { fputs(s, stdout); }
+  void print(char c)                    { fputc(c, stdout); }
+  void print(int v)                     { printf("%d", v); }
+  void print(unsigned v)                { printf("%u", v); }
+  void print(long v)                    { printf("%ld", v); }
+  void print(unsigned long v)           { printf("%lu", v); }
+  void print(double v, int digits = 2)  { printf("%.*f", digits, v); }
+  template <typename T> void println(T v)             { print(v); fputc('\n', stdout); }
+  template <typename T> void println(T v, int digits) { print((double)v, digits); fputc('\n', stdout); }
+  void println()                        { fputc('\n', stdout); }
+};
+extern HostSerial Serial;
+
+#endif
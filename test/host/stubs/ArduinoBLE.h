@@ -0,0 +1,19 @@
+#ifndef HOST_STUB_ARDUINO_BLE_H
+#define HOST_STUB_ARDUINO_BLE_H
+
+// A characteristic whose writeValue() is routed to a harness callback, so a
+// test can record notifications and make them fail.
+
+#include <Arduino.h>
+
+class BLECharacteristic {
+public:
+  /** Called for every writeValue(); return 0 to refuse (central gone). */
+  int (*onWrite)(const uint8_t* value, int len) = nullptr;
+
+  int writeValue(const uint8_t* value, int len) {
+    return onWrite ? onWrite(value, len) : len;
+  }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_STUB_EEPROM_H
+#define HOST_STUB_EEPROM_H
+
+// The sensor headers include EEPROM.h for their calibration records; the
+// host harnesses never touch it.
+
+#endif
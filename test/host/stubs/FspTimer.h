@@ -0,0 +1,34 @@
+#ifndef HOST_STUB_FSP_TIMER_H
+#define HOST_STUB_FSP_TIMER_H
+
+#include <Arduino.h>
+
+// Timer stub: always available, never fires on its own. The harness calls
+// FspTimer::fire() to run the registered callback, one tick at a time.
+
+typedef struct { int event; void* p_context; } timer_callback_args_t;
+enum timer_mode_t { TIMER_MODE_PERIODIC = 0, TIMER_MODE_ONE_SHOT };
+
+class FspTimer {
+public:
+  static int8_t get_available_timer(uint8_t& type) { type = 0; return 0; }
+
+  bool begin(timer_mode_t, uint8_t, uint8_t, float hz, float,
+             void (*cb)(timer_callback_args_t*)) {
+    callback = cb;
+    frequency = hz;
+    return true;
+  }
+  bool setup_overflow_irq()     { return true; }
+  bool open()                   { return true; }
+  bool start()                  { return true; }
+  bool stop()                   { return true; }
+  bool set_frequency(float hz)  { frequency = hz; return true; }
+
+  static void fire() { if (callback) callback(nullptr); }
+
+  static void (*callback)(timer_callback_args_t*);
+  static float frequency;
+};
+
+#endif
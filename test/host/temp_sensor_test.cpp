@@ -0,0 +1,149 @@
+// ============================================
+// HOST HARNESS: TempSensor
+// ============================================
+//
+// Drives the DS18B20 driver against its built-in simulated device
+// (TEMP_SENSOR_SIMULATE) on a simulated millisecond clock: the background
+// conversion collected by tempSensorService(), the bounded wait in
+// tempCollect() including a zero timeout while a conversion is still running,
+// the periodic refresh and the tempAgeMs() freshness that startTest() uses to
+// decide whether to wait at all.
+//
+// Build and run from the repository root:
+//
+//   g++ -std=c++17 -Wall -DTEMP_SENSOR_SIMULATE=1 -I test/host/stubs -I . test/host/temp_sensor_test.cpp -o /tmp/temp_sensor_test
+//   /tmp/temp_sensor_test
+//
+// Exits non-zero if any check fails. TempSensor.cpp is included directly.
+
+#if !TEMP_SENSOR_SIMULATE
+#error "build with -DTEMP_SENSOR_SIMULATE=1"
+#endif
+
+#include "../../TempSensor.cpp"
+
+// ============================================
+// SIMULATED HARDWARE
+// ============================================
+
+HostSerial Serial;
+
+static unsigned long simMs = 0;
+
+unsigned long millis() { return simMs; }
+unsigned long micros() { return simMs * 1000UL; }
+void delay(unsigned long ms) { simMs += ms; }
+
+/** Let `ms` pass with the main loop calling tempSensorService() every 10 ms. */
+static void runLoop(unsigned long ms) {
+  for (unsigned long t = 0; t < ms; t += 10) {
+    tempSensorService();
+    simMs += 10;
+  }
+}
+
+/** Run the loop until the pending conversion is collected (or maxMs passes). */
+static void runUntilCollected(unsigned long maxMs) {
+  for (unsigned long t = 0; t < maxMs && tempConversionPending(); t += 10) {
+    tempSensorService();
+    simMs += 10;
+  }
+}
+
+// ============================================
+// CHECKS
+// ============================================
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float got, float want) {
+  printf("%s  %-52s got %10.3f  want %10.3f\n", ok ? "PASS" : "FAIL", what, got, want);
+  if (!ok) failures++;
+}
+
+/** Init starts a conversion; the loop collects it once the part is done. */
+static void testBackgroundConversion() {
+  check(tempAgeMs() == ULONG_MAX, "no reading yet: age is ULONG_MAX", 0, 0);
+  check(tempLatestC() == TEMP_DEFAULT_C, "no reading yet: default temperature",
+        tempLatestC(), TEMP_DEFAULT_C);
+
+  const unsigned long t0 = millis();
+  bool found = tempSensorInit();
+  check(found && tempSensorPresent(), "init finds the simulated DS18B20", found, 1);
+  check(tempConversionPending(), "init starts a conversion", tempConversionPending(), 1);
+
+  runLoop(tempConversionMs() - 50);
+  check(tempConversionPending(), "still pending before the conversion time",
+        tempConversionPending(), 1);
+  check(tempAgeMs() == ULONG_MAX, "nothing published mid-conversion", 0, 0);
+
+  runUntilCollected(200);
+  check(!tempConversionPending(), "service collects the finished conversion",
+        tempConversionPending(), 0);
+  check(millis() - t0 <= tempConversionMs() + 10, "collected within a pass of done",
+        (float)(millis() - t0), (float)tempConversionMs());
+  check(tempLatestC() == TEMP_SIMULATE_C, "reading is the simulated temperature",
+        tempLatestC(), TEMP_SIMULATE_C);
+  check(tempAgeMs() <= 10, "fresh reading is at most one loop pass old",
+        (float)tempAgeMs(), 10.0f);
+}
+
+/** tempCollect(0) while pending times out without touching the last reading. */
+static void testCollectTimeout() {
+  tempSimulateSet(30.0f);
+  tempStartConversion();
+  check(tempConversionPending(), "explicit start is pending", tempConversionPending(), 1);
+
+  unsigned long t0 = millis();
+  check(!tempCollect(0), "collect(0) while converting times out", 0, 0);
+  check(millis() == t0, "collect(0) does not wait", (float)(millis() - t0), 0.0f);
+  check(tempConversionPending(), "timed-out conversion stays pending", tempConversionPending(), 1);
+  check(tempLatestC() == TEMP_SIMULATE_C, "timeout keeps the previous reading",
+        tempLatestC(), TEMP_SIMULATE_C);
+
+  check(tempCollect(tempConversionMs()), "bounded wait collects the conversion", 1, 1);
+  check(tempLatestC() == 30.0f, "collected reading is the new temperature", tempLatestC(), 30.0f);
+  check(millis() - t0 <= tempConversionMs() + 5, "wait ends within one poll of done",
+        (float)(millis() - t0), (float)tempConversionMs());
+
+  check(!tempCollect(1000), "collect with nothing pending returns at once", 0, 0);
+}
+
+/** Age grows between refreshes; the loop restarts a conversion every TEMP_REFRESH_MS. */
+static void testFreshness() {
+  // The last conversion was started explicitly; the next refresh is due
+  // TEMP_REFRESH_MS after that start.
+  runLoop(TEMP_REFRESH_MS - tempConversionMs() - 100);
+  check(!tempConversionPending(), "idle until the refresh period", tempConversionPending(), 0);
+  unsigned long age = tempAgeMs();
+  check(age >= TEMP_REFRESH_MS - tempConversionMs() - 110 && age < TEMP_REFRESH_MS,
+        "age grows while idle", (float)age, (float)(TEMP_REFRESH_MS - tempConversionMs()));
+
+  // A reading younger than TEMP_REFRESH_MS is what startTest() takes instead
+  // of waiting on a pending conversion.
+  check(age < TEMP_REFRESH_MS, "reading still counts as fresh", (float)age, (float)TEMP_REFRESH_MS);
+
+  tempSimulateSet(18.0f);
+  runLoop(200);
+  check(tempConversionPending(), "refresh conversion started by service", tempConversionPending(), 1);
+  runUntilCollected(tempConversionMs() + 50);
+  check(tempLatestC() == 18.0f, "refresh publishes the new temperature", tempLatestC(), 18.0f);
+  check(tempAgeMs() <= 10, "refresh resets the age", (float)tempAgeMs(), 10.0f);
+}
+
+/** An implausible reading is rejected and the previous one kept. */
+static void testOutOfRange() {
+  tempSimulateSet(70.0f);
+  tempStartConversion();
+  check(!tempCollect(tempConversionMs() + 50), "out-of-range reading is rejected", 0, 0);
+  check(tempLatestC() == 18.0f, "rejected read keeps the previous value", tempLatestC(), 18.0f);
+}
+
+int main() {
+  testBackgroundConversion();
+  testCollectTimeout();
+  testFreshness();
+  testOutOfRange();
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}